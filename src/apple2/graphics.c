@@ -513,7 +513,7 @@ void drawGamefield(uint8_t quadrant, uint8_t *field)
   uint16_t pos;
   uint8_t baseX;
   uint8_t baseY;
-  uint8_t i, x, y;
+  uint8_t i, x, y, c, bits, left;
   uint8_t charCode;
   uint8_t actualX;
 
@@ -521,15 +521,16 @@ void drawGamefield(uint8_t quadrant, uint8_t *field)
   baseX = (uint8_t)(pos % 40);  // WIDTH = 40
   baseY = (uint8_t)(pos / 40);  // WIDTH = 40
 
-  for (i = 0; i < 100; i++)
+  left = 0;
+  for (i = 0; i < FIELD_CELLS; i++)
   {
-      if (field[i])
+      if (c = FIELD_NEXT_CELL(field, bits, left))
       {
           x = i % 10;
           y = i / 10;
           actualX = baseX + x;
           
-          if (field[i] == FIELD_ATTACK)
+          if (c == FIELD_ATTACK)
           {
               // If actual x coordinate is even then EVEN, if odd then ODD
               charCode = (actualX % 2) ? HIT_NORMAL_ODD : HIT_NORMAL_EVEN;
@@ -558,7 +559,7 @@ void drawGamefieldUpdate(uint8_t quadrant, uint8_t *gamefield, uint8_t attackPos
     baseY = (uint8_t)(pos / 40);  // WIDTH = 40
     x = attackPos % 10;
     y = attackPos / 10;
-    c = gamefield[attackPos];
+    c = FIELD_CELL(gamefield, attackPos);
 
     // Animate attack
     if (anim > 9)
@@ -603,7 +604,7 @@ void drawGamefieldCursor(uint8_t quadrant, uint8_t x, uint8_t y, uint8_t *gamefi
     pos = fieldX + quadrant_offset[quadrant];
     baseX = (uint8_t)(pos % 40);  // WIDTH = 40
     baseY = (uint8_t)(pos / 40);  // WIDTH = 40
-    c = gamefield[y * 10 + x];
+    c = FIELD_CELL(gamefield, y * 10 + x);
 
     if (blink)
     {
@@ -490,18 +490,18 @@ void drawLegendShip(uint8_t player, uint8_t index, uint8_t size, uint8_t status)
 
 void drawGamefield(uint8_t quadrant, uint8_t *field)
 {
-    static uint8_t y, x;
+    static uint8_t y, x, c, bits, left;
     uint8_t *dest = SCREEN_LOC + quadrant_offset[quadrant] + fieldX;
 
+    left = 0;
     for (y = 0; y < 10; ++y)
     {
         for (x = 0; x < 10; ++x)
         {
-            if (*field)
+            if (c = FIELD_NEXT_CELL(field, bits, left))
             {
-                *dest = *field == 1 ? TILE_HIT : TILE_MISS;
+                *dest = c == FIELD_ATTACK ? TILE_HIT : TILE_MISS;
             }
-            field++;
             dest++;
         }
 
@@ -513,7 +513,7 @@ static bool cursorVisible = false;
 void drawGamefieldUpdate(uint8_t quadrant, uint8_t *gamefield, uint8_t attackPos, uint8_t anim)
 {
     uint8_t *dest = SCREEN_LOC + quadrant_offset[quadrant] + fieldX + (uint16_t)(attackPos / 10) * WIDTH + (attackPos % 10);
-    uint8_t c = gamefield[attackPos];
+    uint8_t c = FIELD_CELL(gamefield, attackPos);
 
     if (cursorVisible)
     {
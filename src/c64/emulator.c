@@ -9,6 +9,7 @@
 #include <stdbool.h>
 #include <stdint.h>
 #include "../misc.h"
+#include "../fujinet-network.h"
 
 #define MAX_APPKEY_LEN 64
 #define APPKEY_READ  0
@@ -61,47 +62,85 @@ appkeyC64 appkey;
 
 #ifdef CUSTOM_FUJINET_CALLS 
 
-int16_t custom_network_call(char *url, uint8_t *buffer, uint16_t max_len)
-{
-    int16_t count;
-    int8_t  i, wait;
+// Check for a response every frame while a fast answer is likely (a local server), then back off to spare the bus
+#define POLL_FAST_FRAMES 30
+#define POLL_SLOW_DELAY 4
+
+static bool responseReady, responseEnd;
+static uint8_t pollDelay, pollCount;
 
-    // Delete existing file
-    cbm_open(15,11,15, "s:vice-in"); 
+uint8_t custom_network_open(char *devicespec, uint8_t mode, uint8_t trans)
+{
+    (void)mode;
+    (void)trans;
 
-    // Write command file (currently just the url )
+    // Write command file (currently just the url). There is no need to delete the last vice-in first,
+    // as the bridge replaces it whole before it removes vice-out.
     cbm_open(N_LFN,11,1,"vice-out"); 
-    cbm_write(N_LFN, url, strlen(url)); 
+    cbm_write(N_LFN, devicespec, strlen(devicespec)); 
     cbm_close(N_LFN);
 
-    // Wait until command file no longer exists (signifies a response is ready) */
-    buffer[0]=0; 
-    wait=0; 
-    count = 1;
-    while (count != 0 ) {
+    // The response is picked up by custom_network_status, so the caller is not blocked while waiting
+    responseReady = responseEnd = false;
+    pollDelay = pollCount = 0;
 
-        // If we timed out (>15 seconds), return false 
-        wait++; 
-        if (wait > 90) {
-        return 0;
-        }
+    return FN_ERR_OK;
+}
+
+uint8_t custom_network_status(char *devicespec, uint16_t *bw, uint8_t *c, uint8_t *err)
+{
+    static uint8_t count;
+    (void)devicespec;
+    *err = 0;
 
-        // Short delay
-        for (i=0;i<10;i++) { 
-        waitvsync(); 
-        } 
+    if (!responseReady) {
+        *bw = 0;
+        *c = 1;
+
+        // Check if the command file no longer exists (signifies a response is ready) by renaming it
+        if (pollCount < POLL_FAST_FRAMES)
+            pollCount++;
+        else if (++pollDelay < POLL_SLOW_DELAY)
+            return FN_ERR_OK;
+        pollDelay = 0;
 
-        // Check if file exists by renaming it
         count = cbm_open(15,11,15, "r0:vice-out=vice-out"); 
         cbm_close(15); 
-    } 
+        if (count != 0)
+            return FN_ERR_OK;
 
-    // Read the response into the buffer 
-    cbm_open(N_LFN,11,0,"vice-in"); 
-    count = cbm_read(N_LFN,buffer, max_len); 
-    cbm_close(N_LFN); 
+        // Open the response so it can be read in one or more parts, like a network channel
+        if (cbm_open(N_LFN,11,0,"vice-in"))
+            return FN_ERR_IO_ERROR;
 
-    return count;
+        responseReady = true;
+    }
+
+    // The response size is not known up front, so report a full page waiting until the end of the file
+    *bw = responseEnd ? 0 : 256;
+    *c = !responseEnd;
+    return FN_ERR_OK;
+}
+
+int16_t custom_network_read_nb(char *devicespec, uint8_t *buf, uint16_t len)
+{
+    static int16_t count;
+    (void)devicespec;
+
+    count = cbm_read(N_LFN, buf, len);
+    if (count < (int16_t)len)
+        responseEnd = true;
+
+    return count < 0 ? 0 : count;
+}
+
+uint8_t custom_network_close(char *devicespec)
+{
+    (void)devicespec;
+    if (responseReady)
+        cbm_close(N_LFN); 
+    responseReady = false;
+    return FN_ERR_OK;
 }
 
 unsigned char open_appkey(unsigned char open_mode, unsigned int creator_id, unsigned char app_id, char key_id)
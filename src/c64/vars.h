@@ -30,9 +30,18 @@
 #define ICON_CURSOR_ALT 0x5D
 #define ICON_CURSOR_BLIP 0x3E
 
+// The session channel sends http text over a raw socket, which would need PETSCII translation
+#define NO_SESSION_CHANNEL
+
+// The push subscription is the query string, sent as is, so it would also need PETSCII translation
+#define NO_PUSH_NOTIFY
+
 // to enable: make c64 -DUSE_EMULATOR
 #ifdef USE_EMULATOR
 #define CUSTOM_FUJINET_CALLS
+
+// The emulator bridge handles one request per file, so it cannot keep a binary session open either
+#define NO_BINARY_SESSION
 #endif
 
 /**
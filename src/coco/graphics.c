@@ -709,7 +709,7 @@ void drawLegendShip(uint8_t player, uint8_t index, uint8_t size, uint8_t status)
 
 void drawGamefieldCursor(uint8_t quadrant, uint8_t x, uint8_t y, uint8_t *gamefield, uint8_t blink)
 {
-    uint8_t j, c = gamefield[y * 10 + x];
+    uint8_t j, c = FIELD_CELL(gamefield, y * 10 + x);
 
     if (blink)
     {
@@ -739,7 +739,7 @@ uint8_t *srcWaterStart = &charset[(uint16_t)0x6B CHAR_SHIFT];
 
 void drawGamefieldUpdate(uint8_t quadrant, uint8_t *gamefield, uint8_t attackPos, uint8_t anim)
 {
-    uint8_t j, c = gamefield[attackPos];
+    uint8_t j, c = FIELD_CELL(gamefield, attackPos);
     uint8_t *src;
 
     // Animate attack
@@ -770,17 +770,16 @@ void drawGamefieldUpdate(uint8_t quadrant, uint8_t *gamefield, uint8_t attackPos
 
 void drawGamefield(uint8_t quadrant, uint8_t *field)
 {
-    uint8_t y, x, j;
+    uint8_t y, x, j, c, bits, left = 0;
 
     for (y = 0; y < 10; ++y)
     {
         for (x = 0; x < 10; ++x)
         {
-            if (*field)
+            if (c = FIELD_NEXT_CELL(field, bits, left))
             {
-                hires_Draw(quadrant_offset_xy[quadrant][0] + fieldX + x, quadrant_offset_xy[quadrant][1] + y * 8, 1, 8, ROP_CPY, *field == 1 ? srcHit : srcMiss);
+                hires_Draw(quadrant_offset_xy[quadrant][0] + fieldX + x, quadrant_offset_xy[quadrant][1] + y * 8, 1, 8, ROP_CPY, c == FIELD_ATTACK ? srcHit : srcMiss);
             }
-            field++;
         }
     }
 }
@@ -0,0 +1,154 @@
+/*******************************************************************
+ *
+ * Do NOT include standard library headers (e.g. conio, std*).
+ * Instead, add to standard_lib.h, which gets included in misc.h
+ *
+ ******************************************************************/
+
+#include "misc.h"
+
+#if defined(DRAW_QUEUE) && defined(SHADOW_SCREEN)
+#error "A platform draws through either the draw queue or the shadow screen"
+#endif
+
+// The host build has the shadow screen, and builds the queue for its tests
+#if defined(DRAW_QUEUE) || defined(__HOST__)
+
+// Both powers of 2
+#define DRAW_COMMANDS 32
+#define DRAW_TEXT_BYTES 128
+
+// Command ops below 0x80 are a cell of that kind, with its tile in arg
+#define OP_TEXT 0x80  // Text run of arg bytes from the text ring, OP_TEXT | kind
+#define OP_SPACE 0xFF // arg blank cells
+
+typedef struct
+{
+    uint8_t op;
+    uint8_t x;
+    uint8_t y;
+    uint8_t arg;
+} DrawCommand;
+
+static DrawCommand commands[DRAW_COMMANDS];
+static uint8_t text[DRAW_TEXT_BYTES];
+static uint8_t commandHead, commandTail, textHead, textTail;
+
+/// @brief Returns the next free command, drawing the queue first if it is full
+static DrawCommand *nextCommand(uint8_t op, uint8_t x, uint8_t y, uint8_t arg)
+{
+    static DrawCommand *command;
+
+    if ((uint8_t)(commandHead - commandTail) == DRAW_COMMANDS)
+        drainDrawQueue();
+
+    command = &commands[commandHead++ & (DRAW_COMMANDS - 1)];
+    command->op = op;
+    command->x = x;
+    command->y = y;
+    command->arg = arg;
+    return command;
+}
+
+void queueCell(uint8_t x, uint8_t y, uint8_t tile, uint8_t kind)
+{
+    nextCommand(kind, x, y, tile);
+}
+
+void queueText(uint8_t x, uint8_t y, const char *s, uint8_t kind)
+{
+    static uint8_t len;
+
+    len = (uint8_t)strlen(s);
+    if (len > WIDTH)
+        len = WIDTH;
+    if (!len)
+        return;
+
+    if ((uint8_t)(textHead - textTail) > DRAW_TEXT_BYTES - len)
+        drainDrawQueue();
+
+    nextCommand(OP_TEXT | kind, x, y, len);
+    while (len--)
+        text[textHead++ & (DRAW_TEXT_BYTES - 1)] = *s++;
+}
+
+void queueSpace(uint8_t x, uint8_t y, uint8_t w)
+{
+    if (w)
+        nextCommand(OP_SPACE, x, y, w);
+}
+
+void drainDrawQueue()
+{
+    static DrawCommand *command;
+    static uint8_t x, n;
+
+    while (commandTail != commandHead)
+    {
+        command = &commands[commandTail++ & (DRAW_COMMANDS - 1)];
+        x = command->x;
+        n = command->arg;
+
+        if (command->op == OP_SPACE)
+        {
+            drawBlankCells(x, command->y, n);
+        }
+        else if (command->op & OP_TEXT)
+        {
+            while (n--)
+                drawCell(x++, command->y, text[textTail++ & (DRAW_TEXT_BYTES - 1)], command->op & ~OP_TEXT);
+        }
+        else
+        {
+            drawCell(x, command->y, n, command->op);
+        }
+    }
+}
+
+void clearDrawQueue()
+{
+    commandTail = commandHead;
+    textTail = textHead;
+}
+
+#endif
+
+#ifdef DRAW_QUEUE
+
+void putCell(uint8_t x, uint8_t y, uint8_t tile, uint8_t kind)
+{
+    queueCell(x, y, tile, kind);
+}
+
+void flushScreen()
+{
+    drainDrawQueue();
+}
+
+void drawText(uint8_t x, uint8_t y, const char *s)
+{
+    queueText(x, y, s, CELL_TEXT);
+}
+
+void drawTextAlt(uint8_t x, uint8_t y, const char *s)
+{
+    queueText(x, y, s, CELL_TEXT_ALT);
+}
+
+void drawIcon(uint8_t x, uint8_t y, uint8_t icon)
+{
+    queueCell(x, y, icon, CELL_ICON);
+}
+
+void drawBlank(uint8_t x, uint8_t y)
+{
+    queueCell(x, y, ' ', CELL_TEXT);
+}
+
+void drawSpace(uint8_t x, uint8_t y, uint8_t w)
+{
+    queueSpace(x, y, w);
+}
+
+#endif
@@ -9,6 +9,8 @@
 #include "gamelogic.h"
 #include "stateclient.h"
 #include "screens.h"
+#include "timeline.h"
+#include "task.h"
 
 #ifndef TIMER_WIDTH
 #define TIMER_WIDTH 1
@@ -19,6 +21,14 @@ uint8_t shipPlacements[5] = {0, 0, 0, 0, 0};
 uint8_t shipPlaceIndex = 0;
 char moveBuffer[32];
 
+static uint16_t placeTask, moveTask;
+
+// Full board redraw left for the frames after the state change, a part per frame (see redrawTick)
+static uint8_t redrawPart, redrawParts;
+
+// Game over result to show once the redraw and the winning move have played out: 0 none, 1 shown again, 2 new
+static uint8_t resultPending;
+
 void progressAnim(uint8_t y)
 {
     static uint8_t i;
@@ -49,12 +59,13 @@ void processStateChange()
     state.prevPlayerCount = clientState.game.playerCount;
     state.prevActivePlayer = clientState.game.activePlayer;
     state.prevAttackPos = clientState.game.lastAttackPos;
+    state.moveTimeLeft = clientState.game.moveTime;
 
     if (clientState.game.status >= STATUS_GAMESTART)
     {
         for(i=0;i<clientState.game.playerCount;i++)
         {
-            memcpy(&state.gamefield[i], &clientState.game.players[i].gamefield, 100);
+            memcpy(&state.gamefield[i], &clientState.game.players[i].gamefield, FIELD_PACKED_SIZE);
         }
     } 
 }
@@ -72,6 +83,8 @@ void renderLobby()
         
         // Clear gamefield
         memset(state.gamefield, 0, sizeof(state.gamefield));
+        timelineClear();
+        redrawCancel();
 
         resetScreen();
 
@@ -139,17 +152,106 @@ void renderLobby()
     // pause(10);
 }
 
-void handleShipPlacement()
+/// @brief Draws part i of a full board redraw: this player's ships and gamefield, then another player's gamefield
+static void drawRedrawPart(uint8_t i)
+{
+    static uint8_t j;
+
+    if (!i && clientState.game.playerStatus != PLAYER_STATUS_VIEWING)
+    {
+        for (j = 0; j < 5; j++)
+            drawShip(0, shipSize[j], clientState.game.myShips[j], DRAWSHIP_SHOW);
+    }
+
+    drawGamefield(i, clientState.game.players[i].gamefield);
+}
+
+/// @brief Reveals the winner's ships (if not this player) and shows the result of the game
+static void drawGameOver()
+{
+    static uint8_t i;
+
+    if (clientState.game.activePlayer > 0)
+    {
+        for (i = 0; i < 5; i++)
+        {
+            drawShip(clientState.game.activePlayer, shipSize[i], clientState.game.myShips[5 + i], DRAWSHIP_SHOW);
+        }
+
+        drawGamefield(clientState.game.activePlayer, clientState.game.players[clientState.game.activePlayer].gamefield);
+    }
+
+    drawEndgameMessage(clientState.game.prompt);
+
+    if (resultPending > 1)
+    {
+        soundGameDone();
+
+        // Send this game's network stats for testing, with the next poll
+        if (prefs.debugFlag)
+            queueStatsUpload();
+
+        // The result stays up until the player presses the button (processInput), while polling carries on
+        clearCommonInput();
+    }
+    resultPending = 0;
+}
+
+void redrawTick()
+{
+    // A response may be part way into clientState between frames
+    if (!apiStateComplete())
+        return;
+
+    if (redrawPart < redrawParts)
+        drawRedrawPart(redrawPart++);
+    else if (resultPending && !timelineBusy())
+        drawGameOver();
+    else
+        return;
+
+    // Once the job is done, draw whatever a platform's capped flush (MS-DOS) left over, rather than a few cells a frame
+    if (!redrawBusy())
+        flushScreen();
+}
+
+bool redrawBusy()
+{
+    return redrawPart < redrawParts || resultPending;
+}
+
+#ifdef __HOST__
+void redrawFinish()
 {
-    uint8_t i, x, y, dir, pos, size, change, blink, maxW, maxH, canPlace;
+    while (redrawPart < redrawParts)
+        drawRedrawPart(redrawPart++);
+}
+#endif
+
+void redrawCancel()
+{
+    redrawPart = redrawParts = resultPending = 0;
+}
+
+/// @brief Marks the ships placed so far in tempBuffer, which the state client also reads into between frames
+static void markPlacedShips()
+{
+    static uint8_t i;
 
-    // Use tempBuffer to track occupied cells while placing ships
     memset(tempBuffer, 0, sizeof(tempBuffer));
+    for (i = 0; i < shipPlaceIndex; i++)
+        markShip(shipSize[i], shipPlacements[i]);
+}
+
+uint8_t shipPlacementTask()
+{
+    static uint8_t i, x, y, dir, pos, size, change, blink, maxW, maxH;
+
+    TASK_BEGIN(placeTask);
 
     for (i = 0; i < shipPlaceIndex; i++)
     {
-        pos = shipPlacements[i];
-        placeShip(shipSize[i], pos);
+        drawShip(0, shipSize[i], shipPlacements[i], DRAWSHIP_SHOW);
     }
 
     clearCommonInput();
@@ -157,6 +259,7 @@ void handleShipPlacement()
     {
         size = shipSize[shipPlaceIndex];
         // Randomly select new location
+        markPlacedShips();
 
         while (1)
         {
@@ -180,7 +283,6 @@ void handleShipPlacement()
             x = (x % maxW);
             y = (y % maxH);
 
-            waitvsync();
             if (blink == 0 || blink == 16)
             {
                 if (!blink)
@@ -207,7 +309,9 @@ void handleShipPlacement()
 
             blink = (blink + 1) & 31;
 
-            readCommonInput();
+            // Next frame, with its input read by processInput()
+            TASK_YIELD(placeTask);
+
             // Move cursor
             if (input.dirX)
             {
@@ -233,6 +337,7 @@ void handleShipPlacement()
             // Confirm placement
             if (input.trigger)
             {
+                markPlacedShips();
                 if (testShip(size, pos))
                 {
                     placeShip(size, pos);
@@ -261,7 +366,7 @@ void handleShipPlacement()
                 case KEY_ESCAPE:     // Esc
                 case KEY_ESCAPE_ALT: // Esc Alt
                     showInGameMenuScreen();
-                    return;
+                    TASK_EXIT(placeTask);
                     break;
             }
         }
@@ -276,14 +381,16 @@ void handleShipPlacement()
             strcat(moveBuffer, ",");
     }
 
-    sendMove(moveBuffer);
+    queueCommand(moveBuffer);
+
+    TASK_END(placeTask);
 }
 
 void renderGameboard()
 {
 #define LEGEND_X WIDTH / 2 + 8
-    static bool redraw, fullWidth;
-    uint8_t i, j, jj, x, y, dir, pos, size, playedSound, skipAnim = false;
+    static bool redraw;
+    uint8_t i, j, playedSound, blink, delay, skipAnim = false;
 
     // Redraw the entire board when placing ships back to round 0 (ready up)
     redraw = clientState.game.status != state.prevStatus && (clientState.game.status == STATE_INVALID || clientState.game.status == STATUS_PLACE_SHIPS || state.prevStatus == STATUS_PLACE_SHIPS);
@@ -291,6 +398,7 @@ void renderGameboard()
     // Clear screen and draw initial backdrop
     if (redraw || state.drawBoard)
     {
+        timelineClear();
         state.drawBoard = false;
         redraw = true;
         skipAnim = true;
@@ -302,23 +410,15 @@ void renderGameboard()
             centerText(5, "place your five ships");
             centerTextAlt(7, "press R to rotate");
         }
-        if (clientState.game.status >= STATUS_GAMESTART)
-        {
-            // Draw this player's ships
-            if (clientState.game.playerStatus != PLAYER_STATUS_VIEWING)
-            {
-                for (i = 0; i < 5; i++)
-                {
-                    drawShip(0, shipSize[i], clientState.game.myShips[i], DRAWSHIP_SHOW);
-                }
-            }
-
-            // Draw gamefield
-            for (i = 0; i < clientState.game.playerCount; i++)
-            {
-                drawGamefield(i, clientState.game.players[i].gamefield);
-            }
-        }
+        // This player's ships and the gamefields are drawn over the next frames, from the latest state then,
+        // so the poll and input carry on. A redraw still under way starts over.
+        redrawPart = 0;
+        redrawParts = clientState.game.status >= STATUS_GAMESTART ? clientState.game.playerCount : 0;
+    }
+    else
+    {
+        // Whatever is still animating from the last change jumps to its end, before this one starts
+        timelineFinish();
     }
 
     if (clientState.game.status >= STATUS_GAMESTART)
@@ -329,50 +429,39 @@ void renderGameboard()
         }
 
         playedSound = skipAnim;
+        delay = 0;
 
-        // Render gamefield updates
+        // Render gamefield updates. The animations go on the timeline, each starting when the one before
+        // would have ended, and play out a frame at a time from the main loop.
         if (clientState.game.status > STATUS_GAMESTART)
         {
 
             // Animate other player's attack
             if (!skipAnim && state.prevActivePlayer != 0)
             {
-                for (j = 10; j < 16; j++)
+                for (i = 0; i < clientState.game.playerCount; i++)
                 {
-                    for (i = 0; i < clientState.game.playerCount; i++)
-                    {
-                        if (i != state.prevActivePlayer && clientState.game.players[i].playerStatus == PLAYER_STATUS_DEFAULT && state.gamefield[i][clientState.game.lastAttackPos] == 0 )
-                            drawGamefieldUpdate(i, clientState.game.players[i].gamefield, clientState.game.lastAttackPos, j);
-                    }
-                    pause(5);
+                    if (i != state.prevActivePlayer && clientState.game.players[i].playerStatus == PLAYER_STATUS_DEFAULT && FIELD_CELL(state.gamefield[i], clientState.game.lastAttackPos) == 0 )
+                        timelineCell(i, clientState.game.lastAttackPos, 10, 1, 5, false, 5, 0);
                 }
+                delay = 30;
             }
 
             // Animate/render hit/miss
-            for (j = (!skipAnim && clientState.game.status == STATUS_HIT) * 6; j < 255; --j)
+            blink = (!skipAnim && clientState.game.status == STATUS_HIT) * 6;
+            for (i = 0; i < clientState.game.playerCount; i++)
             {
-                for (i = 0; i < clientState.game.playerCount; i++)
-                {
-                    if (i != state.prevActivePlayer && state.gamefield[i][clientState.game.lastAttackPos] == 0)
-                        drawGamefieldUpdate(i, clientState.game.players[i].gamefield, clientState.game.lastAttackPos, j & 1);
-                }
-                if (!playedSound)
-                {
-                    if (clientState.game.status > STATUS_MISS)
-                    {
-                        soundHit();
-                    }
-                    else
-                    {
-                        soundMiss();
-                    }
-                    playedSound = 1;
-                }
-
-                pause(4);
+                if (i != state.prevActivePlayer && FIELD_CELL(state.gamefield[i], clientState.game.lastAttackPos) == 0)
+                    timelineCell(i, clientState.game.lastAttackPos, blink, -1, blink, true, 4, delay);
+            }
+            if (!playedSound)
+            {
+                timelineSound(clientState.game.status > STATUS_MISS ? TIMELINE_SOUND_HIT : TIMELINE_SOUND_MISS, delay);
             }
+            delay += (blink + 1) * 4;
         }
 
+        playedSound = false;
         for (i = 0; i < clientState.game.playerCount; i++)
         {
             // Draw ships left indicators on legend
@@ -381,13 +470,10 @@ void renderGameboard()
                 // Animate a ship being sunk
                 if (!skipAnim && state.shipsLeft[i][j] != clientState.game.players[i].shipsLeft[j])
                 {
-                    for (jj = 0; jj < 5; jj++)
-                    {
-                        pause(4);
-                        drawLegendShip(i, j, shipSize[j], jj & 1);
-                    }
-
-                    soundSink();
+                    timelineLegend(i, j, 4, clientState.game.players[i].shipsLeft[j], 4, delay + 4);
+                    if (!playedSound)
+                        timelineSound(TIMELINE_SOUND_SINK, delay + 20);
+                    playedSound = true;
                 }
                 else
                 {
@@ -421,46 +507,26 @@ void renderGameboard()
                 // Blink active player
                 if (clientState.game.activePlayer > 0)
                 {
-
-                    pause(15);
-                    drawPlayerName(clientState.game.activePlayer, clientState.game.players[clientState.game.activePlayer].name, false);
-
-                    pause(15);
-                    drawPlayerName(clientState.game.activePlayer, clientState.game.players[clientState.game.activePlayer].name, true);
-                    pause(15);
+                    timelinePlayerName(clientState.game.activePlayer, 1, true, 15, 15);
                 }
             }
         }
     }
 
-    // Display the gameover message and play a sound if the state just changed
+    // Display the gameover message and play a sound if the state just changed. The redraw job shows it
+    // once the board and the winning move have played out (redrawTick).
     if (clientState.game.status == STATUS_GAMEOVER && (redraw || clientState.game.status != state.prevStatus))
     {
-        // Reveal winning player's ships (if not this player)
-        waitvsync();
-        if (clientState.game.activePlayer > 0)
+        if (clientState.game.status != state.prevStatus)
         {
-            for (i = 0; i < 5; i++)
-            {
-                drawShip(clientState.game.activePlayer, shipSize[i], clientState.game.myShips[5 + i], DRAWSHIP_SHOW);
-            }
+            resultPending = 2;
 
-            drawGamefield(clientState.game.activePlayer, clientState.game.players[clientState.game.activePlayer].gamefield);
+            // Later states wait behind the result
+            state.waitingOnEndGameContinue = true;
         }
-
-        drawEndgameMessage(clientState.game.prompt);
-
-        if (clientState.game.status != state.prevStatus)
+        else if (!resultPending)
         {
-            soundGameDone();
-
-            // Wait for user to press button to close game result
-            clearCommonInput();
-            while (!input.trigger)
-            {
-                waitvsync();
-                readCommonInput();
-            }
+            resultPending = 1;
         }
     }
 
@@ -471,7 +537,11 @@ void renderGameboard()
         {
             if (clientState.game.playerStatus == PLAYER_STATUS_PLACE_SHIPS)
             {
-                handleShipPlacement();
+                // Ships placed so far. processInput() places the rest, a frame at a time.
+                for (i = 0; i < shipPlaceIndex; i++)
+                {
+                    drawShip(0, shipSize[i], shipPlacements[i], DRAWSHIP_SHOW);
+                }
             }
             else
             {
@@ -488,15 +558,19 @@ void renderGameboard()
             centerTextAlt(7, "                   ");
         }
     }
-    pause(30);
     // cgetc();
     // pause(60);
 }
 
 void placeShip(uint8_t shipSize, uint8_t pos)
 {
-    uint8_t i;
     drawShip(0, shipSize, pos, DRAWSHIP_SHOW);
+    markShip(shipSize, pos);
+}
+
+void markShip(uint8_t shipSize, uint8_t pos)
+{
+    uint8_t i;
     for (i = 0; i < shipSize; i++)
     {
         tempBuffer[pos % 100] = 1;
@@ -519,14 +593,39 @@ bool testShip(uint8_t shipSize, uint8_t pos)
     return true;
 }
 
+/// @brief Clears the aiming cursor from the opponents' gamefields
+static void hideCursor()
+{
+    static uint8_t i;
+
+    for (i = 1; i < clientState.game.playerCount; i++)
+    {
+        if (clientState.game.players[i].playerStatus == PLAYER_STATUS_DEFAULT)
+            drawGamefieldCursor(i, posX, posY, clientState.game.players[i].gamefield, 0);
+    }
+}
+
 void processInput()
 {
-    waitvsync();
+    // Wait for the rest of the state to come in before acting on it
+    if (apiReceivingState())
+        return;
+
     readCommonInput();
 
+    // Drop a flow the latest state no longer calls for, e.g. the server moved on when the time ran out
+    if (clientState.game.status != STATUS_PLACE_SHIPS || clientState.game.playerStatus != PLAYER_STATUS_PLACE_SHIPS)
+        placeTask = 0;
+    if (moveTask && (clientState.game.activePlayer != 0 || clientState.game.status == STATUS_GAMEOVER))
+    {
+        hideCursor();
+        moveTask = 0;
+    }
+
     if (state.waitingOnEndGameContinue)
     {
-        if (input.trigger)
+        // Not before the result is up
+        if (input.trigger && !resultPending)
         {
             state.waitingOnEndGameContinue = false;
             //  clearRenderState();
@@ -546,15 +645,22 @@ void processInput()
             else
                 soundInvalid();
 
-            apiCall("ready");
+            // Local feedback above is instant, the server hears about it in the background
+            queueCommand("ready");
             clearCommonInput();
             return;
         }
 
-        // Wait on this player to attack
-        if (clientState.game.activePlayer == 0 && clientState.game.status >= STATUS_GAMESTART)
+        // Place this player's ships, until all five are sent
+        if (clientState.game.status == STATUS_PLACE_SHIPS && clientState.game.playerStatus == PLAYER_STATUS_PLACE_SHIPS && (placeTask || shipPlaceIndex < 5))
         {
-            waitOnPlayerMove();
+            shipPlacementTask();
+        }
+
+        // Wait on this player to attack. At game over the active player is the winner, who has nothing left to attack.
+        if (clientState.game.activePlayer == 0 && clientState.game.status >= STATUS_GAMESTART && clientState.game.status != STATUS_GAMEOVER && state.moveTimeLeft)
+        {
+            playerMoveTask();
         }
     }
 
@@ -567,26 +673,32 @@ void processInput()
     }
 }
 
-void waitOnPlayerMove()
+void resetInputTasks()
 {
-    bool foundValidLocation;
-    uint8_t waitCount, frames, lastFrame, i, j, moved, attackPos;
-    uint16_t jifsPerSecond, maxJifs;
+    placeTask = moveTask = 0;
+}
 
-    resetTimer();
+uint8_t playerMoveTask()
+{
+    static uint8_t waitCount, frames, lastFrame, i, moved, attackPos;
+    static uint16_t jifsPerSecond, maxJifs, startTime;
+
+    TASK_BEGIN(moveTask);
+
+    // Timed from now, as the state client times its calls on the same clock
+    startTime = getTime();
 
     // Determine max jiffies for PAL and NTS
     jifsPerSecond = getJiffiesPerSecond();
-    maxJifs = jifsPerSecond * clientState.game.moveTime;
+    maxJifs = jifsPerSecond * state.moveTimeLeft;
     waitCount = 0;
     moved = frames = 9;
 
-    // Move selection loop
-    while (clientState.game.moveTime > 0)
+    // Move selection loop, a frame at a time
+    while (state.moveTimeLeft > 0)
     {
         frames = (frames + 1) % 30;
         i = frames / 10;
-        waitvsync();
         if (moved || i != lastFrame)
         {
             
@@ -626,7 +738,7 @@ void waitOnPlayerMove()
             // Check if at least one enemy cell is valid to attack
             for (i = 1; i < clientState.game.playerCount; i++)
             {
-                if (clientState.game.players[i].playerStatus == PLAYER_STATUS_DEFAULT && state.gamefield[i][attackPos] == 0 )
+                if (clientState.game.players[i].playerStatus == PLAYER_STATUS_DEFAULT && FIELD_CELL(state.gamefield[i], attackPos) == 0 )
                     break;
             }
 
@@ -640,36 +752,36 @@ void waitOnPlayerMove()
                 // Attack!
                 soundAttack();
                 
-                // Animate attack / clear cursor
-                for (j = 10; j < 16; j++)
+                // Animate attack / clear cursor, while the attack is sent
+                for (i = 1; i < clientState.game.playerCount; i++)
                 {
-                    for (i = 1; i < clientState.game.playerCount; i++)
-                    {
-                        if (clientState.game.players[i].playerStatus == PLAYER_STATUS_DEFAULT)
-                            drawGamefieldUpdate(i, clientState.game.players[i].gamefield, attackPos, state.gamefield[i][attackPos] == 0 ?  j : 0);
-                    }
-                    pause(5);
+                    if (clientState.game.players[i].playerStatus != PLAYER_STATUS_DEFAULT)
+                        continue;
+
+                    if (FIELD_CELL(state.gamefield[i], attackPos) == 0)
+                        timelineCell(i, attackPos, 10, 1, 5, false, 5, 0);
+                    else
+                        drawGamefieldUpdate(i, clientState.game.players[i].gamefield, attackPos, 0);
                 }
 
                 // Send command to score this value
                 strcpy(moveBuffer, "attack/");
                 itoa(attackPos, moveBuffer + strlen(moveBuffer), 10);
-                sendMove(moveBuffer);
+                queueCommand(moveBuffer);
+
+                // Done with this turn. The server's answer brings the next move time.
+                state.moveTimeLeft = 0;
 
                 // Clear timer
                 drawSpace(WIDTH - TIMER_WIDTH - 2, HEIGHT - 1, 2 + TIMER_WIDTH);
-                return;
+                TASK_EXIT(moveTask);
             }
         }
 
         // Update cursor
         if (input.dirX || input.dirY)
         {
-            for (i = 1; i < clientState.game.playerCount; i++)
-            {
-                if (clientState.game.players[i].playerStatus == PLAYER_STATUS_DEFAULT)
-                    drawGamefieldCursor(i, posX, posY, clientState.game.players[i].gamefield, 0);
-            }
+            hideCursor();
             posX = (posX + 10 + input.dirX) % 10;
             posY = (posY + 10 + input.dirY) % 10;
             moved = 1;
@@ -679,10 +791,10 @@ void waitOnPlayerMove()
         if (++waitCount > 5)
         {
             waitCount = 0;
-            i = (uint8_t)((maxJifs - getTime()) / jifsPerSecond);
-            if (i <= 20 && i != clientState.game.moveTime)
+            i = (uint8_t)((maxJifs - (uint16_t)(getTime() - startTime)) / jifsPerSecond);
+            if (i <= 20 && i != state.moveTimeLeft)
             {
-                clientState.game.moveTime = i;
+                state.moveTimeLeft = i;
                 if (i < 10)
                     tempBuffer[0] = ' ';
 
@@ -698,20 +810,17 @@ void waitOnPlayerMove()
         {
         case KEY_ESCAPE:
         case KEY_ESCAPE_ALT:
-            for (i = 1; i < clientState.game.playerCount; i++)
-            {
-                if (clientState.game.players[i].playerStatus == PLAYER_STATUS_DEFAULT)
-                    drawGamefieldCursor(i, posX, posY, clientState.game.players[i].gamefield, 0);
-            }
+            hideCursor();
             showInGameMenuScreen();
-            return;
+            TASK_EXIT(moveTask);
         }
 
-        // Read input for next iteration
-        readCommonInput();
+        // Next frame, with its input read by processInput()
+        TASK_YIELD(moveTask);
     }
 
     // Timed out
+    TASK_END(moveTask);
 }
 
 uint8_t prevCursorPos;
@@ -762,7 +871,8 @@ void resetInputField()
 /// @brief Handles available key strokes for the defined input box (player name and chat). Returns true if user hits enter
 bool inputFieldCycle(uint8_t x, uint8_t y, uint8_t max, char *buffer)
 {
-    uint8_t curx, lastY;
+    // Kept between calls, as the field is edited a key at a time
+    static uint8_t curx, lastY;
 
     // Initialize first call to input box
     if (inputField_done == 1 || lastY != y)
@@ -775,6 +885,9 @@ bool inputFieldCycle(uint8_t x, uint8_t y, uint8_t max, char *buffer)
         enableKeySounds();
     }
 
+    // Show the field before looking for keys, as the caller may not wait for vsync
+    flushScreen();
+
     // Process any waiting keystrokes
     if (kbhit())
     {
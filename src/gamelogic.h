@@ -6,8 +6,33 @@ void renderLobby();
 void renderGameboard();
 void handleAnimation();
 
+/// @brief Input task: reads the input once, then steps the flow it drives (ready, ship placement, aiming)
 void processInput();
 
+/// @brief Places this player's ships a frame at a time, then queues them. Returns TASK_RUNNING until done.
+uint8_t shipPlacementTask();
+
+/// @brief Moves the cursor a frame at a time until this player attacks or the time runs out. Returns TASK_RUNNING until done.
+uint8_t playerMoveTask();
+
+/// @brief Drops the placement and aiming flows, to start over
+void resetInputTasks();
+
+/// @brief Draws the next part of a full board redraw, if one is under way: a gamefield per frame.
+/// At game over, then shows the result once the animations have played out. Call once per vsync.
+void redrawTick();
+
+/// @brief Returns true while a full board redraw has parts left to draw, or the game over result is still to show
+bool redrawBusy();
+
+#ifdef __HOST__
+/// @brief Draws the rest of a full board redraw right away (host builds only)
+void redrawFinish();
+#endif
+
+/// @brief Drops the rest of a full board redraw, when the board is going away
+void redrawCancel();
+
 void clearRenderState();
 
 void centerText(uint8_t y, const char *text);
@@ -18,11 +43,10 @@ void centerStatusText(const char *text);
 void resetInputField();
 bool inputFieldCycle(uint8_t x, uint8_t y, uint8_t max, char *buffer);
 
-void waitOnPlayerMove();
-
 void progressAnim(uint8_t y);
 
 void placeShip(uint8_t shipSize, uint8_t pos);
+void markShip(uint8_t shipSize, uint8_t pos);
 bool testShip(uint8_t shipSize, uint8_t pos);
 
 #endif /*GAMELOGIC_H*/
@@ -0,0 +1,189 @@
+/*
+  Graphics functionality for the headless host build - records what is drawn instead of showing it
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include "../misc.h"
+#include "host.h"
+
+HostStats hostStats;
+char hostScreen[HEIGHT][WIDTH + 1];
+uint8_t hostField[PLAYER_MAX][FIELD_CELLS];
+uint32_t hostFrameLimit;
+uint16_t hostFlushCells;
+jmp_buf *hostEscape;
+void (*hostFrameHook)();
+
+static uint8_t color;
+
+void putChar(uint8_t x, uint8_t y, char c)
+{
+    if (x < WIDTH && y < HEIGHT)
+    {
+        hostScreen[y][x] = c;
+        hostStats.chars++;
+    }
+}
+
+void resetScreen()
+{
+    uint8_t y;
+
+    for (y = 0; y < HEIGHT; y++)
+    {
+        memset(hostScreen[y], ' ', WIDTH);
+        hostScreen[y][WIDTH] = 0;
+    }
+    memset(hostField, 0, sizeof(hostField));
+    resetShadowScreen();
+    hostStats.clears++;
+}
+
+uint8_t cycleNextColor()
+{
+    return ++color;
+}
+
+void initGraphics()
+{
+    resetScreen();
+}
+
+void resetGraphics()
+{
+}
+
+bool saveScreenBuffer()
+{
+    return false;
+}
+
+void restoreScreenBuffer()
+{
+}
+
+void drawCell(uint8_t x, uint8_t y, uint8_t tile, uint8_t kind)
+{
+    putChar(x, y, tile);
+}
+
+void drawBlankCells(uint8_t x, uint8_t y, uint8_t w)
+{
+    while (w--)
+        putChar(x++, y, ' ');
+}
+
+void drawLine(uint8_t x, uint8_t y, uint8_t w)
+{
+    while (w--)
+        drawIcon(x++, y, '-');
+}
+
+void drawBox(uint8_t x, uint8_t y, uint8_t w, uint8_t h)
+{
+    uint8_t i;
+
+    drawLine(x, y, w + 2);
+    drawLine(x, y + h + 1, w + 2);
+    for (i = 1; i <= h; i++)
+    {
+        drawIcon(x, y + i, '|');
+        drawIcon(x + w + 1, y + i, '|');
+    }
+}
+
+void drawClock()
+{
+    drawIcon(WIDTH - 1, HEIGHT - 1, 'c');
+}
+
+void drawConnectionIcon(bool show)
+{
+    drawIcon(0, HEIGHT - 1, show ? '!' : ' ');
+}
+
+void drawPlayerName(uint8_t player, const char *name, bool active)
+{
+    hostStats.names++;
+}
+
+void drawBoard(uint8_t playerCount)
+{
+    hostStats.boards++;
+}
+
+void drawShip(uint8_t quadrant, uint8_t size, uint8_t pos, bool hide)
+{
+    hostStats.ships++;
+}
+
+void drawLegendShip(uint8_t player, uint8_t index, uint8_t size, uint8_t status)
+{
+    hostStats.ships++;
+}
+
+void drawGamefield(uint8_t quadrant, uint8_t *field)
+{
+    static uint8_t i, bits, left, *cell;
+
+    left = 0;
+    cell = hostField[quadrant];
+    for (i = 0; i < FIELD_CELLS; i++)
+        *cell++ = FIELD_NEXT_CELL(field, bits, left);
+
+    hostStats.gamefields++;
+}
+
+void drawGamefieldUpdate(uint8_t quadrant, uint8_t *gamefield, uint8_t attackPos, uint8_t anim)
+{
+    hostField[quadrant][attackPos] = anim > 9 ? anim : FIELD_CELL(gamefield, attackPos);
+    hostStats.cellUpdates++;
+}
+
+void drawGamefieldCursor(uint8_t quadrant, uint8_t x, uint8_t y, uint8_t *gamefield, uint8_t blink)
+{
+    hostStats.cursors++;
+}
+
+void drawEndgameMessage(const char *message)
+{
+    drawText(WIDTH / 2 - (uint8_t)strlen(message) / 2, GAMEOVER_PROMPT_Y, message);
+}
+
+void waitvsync()
+{
+    flushScreenCells(hostFlushCells ? hostFlushCells : 0xFFFF);
+    hostStats.frames++;
+    if (hostFrameHook)
+        hostFrameHook();
+
+    if (hostFrameLimit && hostStats.frames > hostFrameLimit)
+    {
+        if (hostEscape)
+            longjmp(*hostEscape, 1);
+
+        printf("Frame limit of %lu reached\n", (unsigned long)hostFrameLimit);
+        exit(1);
+    }
+}
+
+const char *hostRow(uint8_t y)
+{
+    flushScreen();
+    return hostScreen[y];
+}
+
+bool hostScreenHas(const char *text)
+{
+    uint8_t y;
+
+    flushScreen();
+    for (y = 0; y < HEIGHT; y++)
+    {
+        if (strstr(hostScreen[y], text))
+            return true;
+    }
+
+    return false;
+}
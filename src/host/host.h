@@ -0,0 +1,102 @@
+/*
+  Recording and scripting hooks of the headless host platform, used by the tests and benchmarks
+*/
+#ifndef HOST_H
+#define HOST_H
+
+#include <setjmp.h>
+#include "../misc.h"
+
+typedef struct
+{
+    uint32_t frames;      // waitvsync() calls - the host clock, in jiffies
+    uint32_t chars;       // Characters written to the screen
+    uint32_t clears;      // resetScreen() calls
+    uint32_t boards;      // drawBoard() calls
+    uint32_t gamefields;  // Whole gamefields drawn
+    uint32_t cellUpdates; // Single gamefield cells drawn
+    uint32_t cursors;     // Gamefield cursor draws
+    uint32_t ships;       // Ships drawn or hidden, board and legend
+    uint32_t names;       // Player names drawn
+    uint32_t sounds;
+    uint32_t opens;       // Network requests opened
+    uint32_t sockets;     // tcp and udp sockets opened
+    uint32_t writes;      // Requests and subscriptions written to sockets
+    uint32_t bytesRead;   // Network bytes read
+} HostStats;
+
+extern HostStats hostStats;
+
+// Text screen as drawn, one row per line. Cells still on the shadow screen show at the next waitvsync().
+extern char hostScreen[HEIGHT][WIDTH + 1];
+
+// Last value drawn per gamefield cell, per quadrant: the cell, or the animation frame (10-15)
+extern uint8_t hostField[PLAYER_MAX][FIELD_CELLS];
+
+// Name of the last sound played, e.g. "hit"
+extern const char *hostLastSound;
+
+// Devicespec of the last network request opened
+extern char hostLastUrl[256];
+
+// Bytes last written to a socket, 0 terminated
+extern uint8_t hostLastWrite[256];
+extern uint16_t hostLastWriteLen;
+
+// waitvsync() gives up once the clock passes this many frames (0 = never), so a flow waiting on
+// input the script never sends fails instead of hanging. If hostEscape is set it longjmps there,
+// otherwise the process exits.
+extern uint32_t hostFrameLimit;
+extern jmp_buf *hostEscape;
+
+// Cells waitvsync() draws from the shadow screen (0 = all), to play a platform that caps them like MS-DOS
+extern uint16_t hostFlushCells;
+
+// Called by every waitvsync() when set, e.g. to pace frames in real time against a live server
+extern void (*hostFrameHook)();
+
+/// @brief Clears the recorded screen, stats, input and network queues, and reseeds the random numbers
+void hostReset();
+
+/// @brief Reseeds the random numbers, so simulated players do not all make the same moves
+void hostSeedRandom(uint32_t value);
+
+/// @brief Queues keys, read one per readCommonInput()/cgetc() call
+void hostQueueKeys(const char *keys);
+
+/// @brief Joystick bits for readJoystick() to return, one value per call, then 0 (or from the start again if loop).
+/// Note readCommonInput() needs a press, release and press to trigger after clearCommonInput().
+void hostJoystickScript(const uint8_t *values, uint8_t count, bool loop);
+
+/// @brief Queues a canned response, served to the next network_open()
+void hostQueueResponse(const uint8_t *data, uint16_t len);
+
+/// @brief Queues a canned response read from a file. Returns false if it cannot be read.
+bool hostQueueResponseFile(const char *path);
+
+/// @brief Queues a failed network_open()
+void hostQueueError();
+
+/// @brief Responses left in the queue
+uint8_t hostPendingResponses();
+
+/// @brief Bytes of a response that arrive per frame (0 = all at once), to simulate a slow link
+void hostSetChunk(uint16_t bytes);
+
+/// @brief Lets tcp and udp sockets open (they fail by default). Requests written to a tcp socket take the
+/// queued responses in turn, a queued error being a 503 or an empty binary frame.
+void hostAcceptSockets(bool accept);
+
+/// @brief The server closes the open tcp socket
+void hostDropSocket();
+
+/// @brief Sends a push notification of seq to the open udp socket
+void hostPush(uint16_t seq);
+
+/// @brief Returns the recorded screen row y, as it shows at the next vsync
+const char *hostRow(uint8_t y);
+
+/// @brief Returns true if text appears anywhere on the recorded screen, as it shows at the next vsync
+bool hostScreenHas(const char *text);
+
+#endif /* HOST_H */
@@ -0,0 +1,57 @@
+/*
+  Input for the headless host build - keys and joystick come from the test script
+*/
+
+#include "../misc.h"
+#include "host.h"
+
+static char keys[256];
+static uint8_t keyHead, keyTail;
+static const uint8_t *joystick;
+static uint8_t joyCount, joyPos;
+static bool joyLoop;
+
+void hostResetInput()
+{
+    keyHead = keyTail = joyCount = joyPos = 0;
+}
+
+void hostQueueKeys(const char *s)
+{
+    while (*s)
+        keys[keyTail++] = *s++;
+}
+
+void hostJoystickScript(const uint8_t *values, uint8_t count, bool loop)
+{
+    joystick = values;
+    joyCount = count;
+    joyPos = 0;
+    joyLoop = loop;
+}
+
+uint8_t readJoystick()
+{
+    if (joyPos == joyCount)
+    {
+        if (!joyLoop || !joyCount)
+            return 0;
+        joyPos = 0;
+    }
+
+    return joystick[joyPos++];
+}
+
+unsigned char kbhit()
+{
+    return keyHead != keyTail;
+}
+
+/// @brief Blocks like the real cgetc, a frame at a time, so the frame limit catches a script that ran out of keys
+char cgetc()
+{
+    while (!kbhit())
+        waitvsync();
+
+    return keys[keyHead++];
+}
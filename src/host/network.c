@@ -0,0 +1,391 @@
+/*
+  Network and appkey calls for the headless host build (CUSTOM_FUJINET_CALLS).
+  Each network_open() takes the next canned response queued by the test, which is then
+  read back through network_status()/network_read_nb() like a FujiNet http channel.
+  Once a test accepts sockets, an n:tcp:// socket stays open instead, and each request
+  written to it is answered with the next canned response, framed with http headers, or
+  with the length of a binary session frame. An n:udp:// socket receives pushes.
+*/
+
+#include <stdio.h>
+#include "../misc.h"
+#include "../stateclient.h"
+#include "../fujinet-network.h"
+#include "host.h"
+
+#ifdef __CC65__
+// Built for sim65 (make sim65), where the queue has to fit beside the program in 64k
+#define RESPONSE_QUEUE_SIZE 4
+#define RESPONSE_MAX 512
+#else
+#define RESPONSE_QUEUE_SIZE 32
+#define RESPONSE_MAX 1024
+#endif
+#define RESPONSE_ERROR 0xFFFF // Queued in place of a length to fail the open
+#define SOCKET_MAX (RESPONSE_MAX + 64) // A response with its http headers
+#define PUSH_MAX (API_PUSH_SIZE * 4)
+
+#define APPKEY_SLOTS 8
+
+typedef struct
+{
+    uint16_t len;
+    uint8_t data[RESPONSE_MAX];
+} Response;
+
+typedef struct
+{
+    uint16_t creator;
+    uint8_t app, key;
+    uint16_t len;
+    char data[MAX_APPKEY_LEN];
+} Appkey;
+
+char hostLastUrl[256];
+
+static Response responses[RESPONSE_QUEUE_SIZE];
+static uint8_t responseHead, responseCount;
+static Response *current;   // Response being read, NULL if none is open
+static uint16_t readPos, chunk;
+static uint32_t openFrame;  // Frame the response was opened on, to pace it when chunk is set
+
+static Appkey appkeys[APPKEY_SLOTS];
+
+uint8_t hostLastWrite[256];
+uint16_t hostLastWriteLen;
+
+static bool socketsAccepted;
+static bool socketOpen, socketConnected, socketBinary;
+static uint8_t socketData[SOCKET_MAX];
+static uint16_t socketLen, socketPos;
+static uint32_t writeFrame; // Frame the last request was written on, to pace the response when chunk is set
+static bool pushOpen;
+static uint8_t pushData[PUSH_MAX];
+static uint8_t pushLen;
+
+void hostResetNetwork()
+{
+    responseHead = responseCount = 0;
+    current = NULL;
+    chunk = 0;
+    socketsAccepted = socketOpen = socketConnected = pushOpen = false;
+    hostLastWriteLen = 0;
+}
+
+void hostAcceptSockets(bool accept)
+{
+    socketsAccepted = accept;
+}
+
+void hostDropSocket()
+{
+    socketConnected = false;
+}
+
+void hostPush(uint16_t seq)
+{
+    if (!pushOpen || pushLen + API_PUSH_SIZE > PUSH_MAX)
+        return;
+
+    pushData[pushLen++] = API_PUSH_CHANGED;
+    pushData[pushLen++] = seq & 0xFF;
+    pushData[pushLen++] = seq >> 8;
+}
+
+static bool isSocket(const char *devicespec)
+{
+    return strncmp(devicespec, "n:tcp://", 8) == 0;
+}
+
+static bool isPush(const char *devicespec)
+{
+    return strncmp(devicespec, "n:udp://", 8) == 0;
+}
+
+/// @brief Answers a request written to the socket with the next canned response. An error is a 503, or an empty frame.
+static void serveSocket()
+{
+    static Response *r;
+    static uint16_t len;
+
+    if (!responseCount)
+        return;
+
+    r = &responses[responseHead];
+    responseHead = (responseHead + 1) % RESPONSE_QUEUE_SIZE;
+    responseCount--;
+
+    // Whatever the client did not read of the last response is dropped
+    len = r->len == RESPONSE_ERROR ? 0 : r->len;
+    if (socketBinary)
+    {
+        socketData[0] = len & 0xFF;
+        socketData[1] = len >> 8;
+        socketLen = 2;
+    }
+    else
+    {
+        socketLen = (uint16_t)sprintf((char *)socketData, "HTTP/1.1 %s\r\nContent-Type: application/octet-stream\r\nContent-Length: %u\r\n\r\n",
+                                      r->len == RESPONSE_ERROR ? "503 Service Unavailable" : "200 OK", len);
+    }
+
+    memcpy(socketData + socketLen, r->data, len);
+    socketLen += len;
+    socketPos = 0;
+    writeFrame = hostStats.frames;
+}
+
+static Response *nextSlot()
+{
+    if (responseCount == RESPONSE_QUEUE_SIZE)
+    {
+        printf("Canned response queue is full\n");
+        exit(1);
+    }
+
+    return &responses[(responseHead + responseCount++) % RESPONSE_QUEUE_SIZE];
+}
+
+void hostQueueResponse(const uint8_t *data, uint16_t len)
+{
+    static Response *r;
+
+    r = nextSlot();
+    r->len = len < RESPONSE_MAX ? len : RESPONSE_MAX;
+    memcpy(r->data, data, r->len);
+}
+
+bool hostQueueResponseFile(const char *path)
+{
+    static FILE *f;
+    static Response *r;
+
+    f = fopen(path, "rb");
+    if (f == NULL)
+        return false;
+
+    r = nextSlot();
+    r->len = (uint16_t)fread(r->data, 1, RESPONSE_MAX, f);
+    fclose(f);
+    return true;
+}
+
+void hostQueueError()
+{
+    nextSlot()->len = RESPONSE_ERROR;
+}
+
+uint8_t hostPendingResponses()
+{
+    return responseCount;
+}
+
+void hostSetChunk(uint16_t bytes)
+{
+    chunk = bytes;
+}
+
+uint8_t custom_network_open(char *devicespec, uint8_t mode, uint8_t trans)
+{
+    if (isSocket(devicespec) || isPush(devicespec))
+    {
+        if (!socketsAccepted)
+            return 1;
+
+        hostStats.sockets++;
+        if (isPush(devicespec))
+        {
+            pushOpen = true;
+            pushLen = 0;
+        }
+        else
+        {
+            socketOpen = socketConnected = true;
+            socketBinary = strstr(devicespec, ":" API_BINARY_PORT) != NULL;
+            socketLen = socketPos = 0;
+        }
+        return 0;
+    }
+
+    strncpy(hostLastUrl, devicespec, sizeof(hostLastUrl) - 1);
+    hostStats.opens++;
+
+    if (!responseCount)
+        return 1;
+
+    current = &responses[responseHead];
+    responseHead = (responseHead + 1) % RESPONSE_QUEUE_SIZE;
+    responseCount--;
+    readPos = 0;
+    openFrame = hostStats.frames;
+
+    if (current->len == RESPONSE_ERROR)
+    {
+        current = NULL;
+        return 1;
+    }
+
+    return 0;
+}
+
+uint8_t custom_network_status(char *devicespec, uint16_t *bw, uint8_t *c, uint8_t *err)
+{
+    static uint16_t arrived;
+
+    if (isPush(devicespec))
+    {
+        if (!pushOpen)
+            return 1;
+
+        *bw = pushLen;
+        *c = 1;
+        *err = 1;
+        return 0;
+    }
+
+    if (isSocket(devicespec))
+    {
+        if (!socketOpen)
+            return 1;
+
+        // With a chunk size set, chunk bytes arrive per frame. A dropped connection delivers nothing more.
+        arrived = socketConnected ? socketLen : socketPos;
+        if (chunk && (hostStats.frames - writeFrame + 1) * chunk < arrived)
+            arrived = (uint16_t)((hostStats.frames - writeFrame + 1) * chunk);
+        *bw = arrived > socketPos ? arrived - socketPos : 0;
+        *c = socketConnected;
+        *err = 1;
+        return 0;
+    }
+
+    if (current == NULL)
+        return 1;
+
+    // With a chunk size set, chunk bytes arrive per frame
+    arrived = current->len;
+    if (chunk && (hostStats.frames - openFrame + 1) * chunk < arrived)
+        arrived = (uint16_t)((hostStats.frames - openFrame + 1) * chunk);
+    *bw = arrived - readPos;
+
+    *c = readPos < current->len;
+    *err = *c ? 1 : 136; // EOF once everything was read
+    return 0;
+}
+
+int16_t custom_network_read_nb(char *devicespec, uint8_t *buf, uint16_t len)
+{
+    if (isPush(devicespec))
+    {
+        if (!pushOpen)
+            return -1;
+
+        // Whole datagrams only, as a udp socket delivers them
+        len = len < pushLen ? len - len % API_PUSH_SIZE : pushLen;
+        memcpy(buf, pushData, len);
+        pushLen -= (uint8_t)len;
+        memmove(pushData, pushData + len, pushLen);
+        return len;
+    }
+
+    if (isSocket(devicespec))
+    {
+        if (!socketOpen)
+            return -1;
+
+        if (len > socketLen - socketPos)
+            len = socketLen - socketPos;
+
+        memcpy(buf, socketData + socketPos, len);
+        socketPos += len;
+        hostStats.bytesRead += len;
+        return len;
+    }
+
+    if (current == NULL)
+        return -1;
+
+    if (len > current->len - readPos)
+        len = current->len - readPos;
+
+    memcpy(buf, current->data + readPos, len);
+    readPos += len;
+    hostStats.bytesRead += len;
+    return len;
+}
+
+uint8_t custom_network_close(char *devicespec)
+{
+    if (isPush(devicespec))
+        pushOpen = false;
+    else if (isSocket(devicespec))
+        socketOpen = socketConnected = false;
+    else
+        current = NULL;
+    return 0;
+}
+
+/// @brief Not part of the custom calls, but the sockets send with it
+uint8_t network_write(char *devicespec, uint8_t *buf, uint16_t len)
+{
+    if (isPush(devicespec) ? !pushOpen : !isSocket(devicespec) || !socketOpen || !socketConnected)
+        return 1;
+
+    hostLastWriteLen = len < sizeof(hostLastWrite) - 1 ? len : sizeof(hostLastWrite) - 1;
+    memcpy(hostLastWrite, buf, hostLastWriteLen);
+    hostLastWrite[hostLastWriteLen] = 0;
+    hostStats.writes++;
+
+    // A push subscription and the hello that starts a binary session get no response
+    if (isSocket(devicespec) && !(socketBinary && buf[0] == API_OP_HELLO))
+        serveSocket();
+    return 0;
+}
+
+static Appkey *findAppkey(uint16_t creator_id, uint8_t app_id, uint8_t key_id, bool create)
+{
+    static uint8_t i;
+
+    for (i = 0; i < APPKEY_SLOTS; i++)
+    {
+        if (appkeys[i].len && appkeys[i].creator == creator_id && appkeys[i].app == app_id && appkeys[i].key == key_id)
+            return &appkeys[i];
+    }
+
+    if (create)
+    {
+        for (i = 0; i < APPKEY_SLOTS; i++)
+        {
+            if (!appkeys[i].len)
+                return &appkeys[i];
+        }
+    }
+
+    return NULL;
+}
+
+uint16_t custom_read_appkey(uint16_t creator_id, uint8_t app_id, uint8_t key_id, char *destination)
+{
+    static Appkey *key;
+
+    key = findAppkey(creator_id, app_id, key_id, false);
+    if (key == NULL)
+        return 0;
+
+    memcpy(destination, key->data, key->len);
+    return key->len;
+}
+
+void custom_write_appkey(uint16_t creator_id, uint8_t app_id, uint8_t key_id, uint16_t count, char *data)
+{
+    static Appkey *key;
+
+    key = findAppkey(creator_id, app_id, key_id, true);
+    if (key == NULL || !count)
+        return;
+
+    key->creator = creator_id;
+    key->app = app_id;
+    key->key = key_id;
+    key->len = count < MAX_APPKEY_LEN ? count : MAX_APPKEY_LEN;
+    memcpy(key->data, data, key->len);
+}
@@ -0,0 +1,90 @@
+/*
+  Sound functions for the headless host build - records the last sound instead of playing it
+*/
+
+#include "../misc.h"
+#include "host.h"
+
+const char *hostLastSound;
+
+void play(const char *name)
+{
+    hostLastSound = name;
+    hostStats.sounds++;
+}
+
+void initSound()
+{
+}
+
+void disableKeySounds()
+{
+}
+
+void enableKeySounds()
+{
+}
+
+void soundStop()
+{
+}
+
+void soundCursor()
+{
+    play("cursor");
+}
+
+void soundSelect()
+{
+    play("select");
+}
+
+void soundJoinGame()
+{
+    play("joinGame");
+}
+
+void soundMyTurn()
+{
+    play("myTurn");
+}
+
+void soundGameDone()
+{
+    play("gameDone");
+}
+
+void soundTick()
+{
+    play("tick");
+}
+
+void soundPlaceShip()
+{
+    play("placeShip");
+}
+
+void soundAttack()
+{
+    play("attack");
+}
+
+void soundInvalid()
+{
+    play("invalid");
+}
+
+void soundHit()
+{
+    play("hit");
+}
+
+void soundSink()
+{
+    play("sink");
+}
+
+void soundMiss()
+{
+    play("miss");
+}
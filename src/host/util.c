@@ -0,0 +1,100 @@
+/*
+  Utilities for the headless host build. Time runs on waitvsync() calls rather than the wall clock,
+  and random numbers come from a fixed seed, so every run of a flow is the same.
+*/
+
+#include <stdlib.h>
+#include "../misc.h"
+#include "host.h"
+
+void hostResetInput();
+void hostResetNetwork();
+
+static uint32_t timerStart;
+static uint32_t seed;
+
+void hostReset()
+{
+    memset(&hostStats, 0, sizeof(hostStats));
+    hostLastSound = "";
+    hostLastUrl[0] = 0;
+    hostResetInput();
+    hostResetNetwork();
+    resetScreen();
+    hostStats.clears = 0;
+    timerStart = 0;
+    seed = 1;
+    hostFlushCells = 0;
+}
+
+void hostSeedRandom(uint32_t value)
+{
+    seed = value;
+}
+
+void resetTimer()
+{
+    timerStart = hostStats.frames;
+}
+
+uint16_t getTime()
+{
+    return (uint16_t)(hostStats.frames - timerStart);
+}
+
+void quit()
+{
+    exit(0);
+}
+
+void housekeeping()
+{
+}
+
+uint8_t getJiffiesPerSecond()
+{
+    return 60;
+}
+
+uint8_t getRandomNumber(uint8_t maxExclusive)
+{
+    if (maxExclusive == 0)
+        return 0;
+
+    seed = seed * 1103515245 + 12345;
+    return (uint8_t)((seed >> 16) % maxExclusive);
+}
+
+#ifndef __CC65__
+/// @brief cc65's itoa, which glibc lacks
+char *itoa(int value, char *s, int radix)
+{
+    static const char digits[] = "0123456789abcdefghijklmnopqrstuvwxyz";
+    char *p = s, *q, c;
+    unsigned int v = value;
+
+    if (value < 0 && radix == 10)
+    {
+        *p++ = '-';
+        v = -value;
+    }
+
+    q = p;
+    do
+    {
+        *q++ = digits[v % radix];
+        v /= radix;
+    } while (v);
+    *q-- = 0;
+
+    // Digits came out lowest first
+    while (p < q)
+    {
+        c = *p;
+        *p++ = *q;
+        *q-- = c;
+    }
+
+    return s;
+}
+#endif
@@ -0,0 +1,81 @@
+#ifndef KEYMAP_H
+#define KEYMAP_H
+
+// Headless native build (make host) for tests and benchmarks. Nothing is shown or played,
+// the platform functions record what they were asked to do instead (see host.h).
+
+// Screen dimensions for platform
+
+#define WIDTH 40
+#define HEIGHT 25
+
+// Other platform specific constants
+
+#define ROLL_SOUND_MOD 4      // How often to play roll sound
+#define ROLL_FRAMES 31        // How many roll frames to play
+#define SCORE_CURSOR_ALT 0x80 // Alternate score cursor color (if supported)
+#define BOTTOM_HEIGHT 4       // How high the bottom panel is
+#define SCORES_X 11           // X start of scoreboard
+#define GAMEOVER_PROMPT_Y HEIGHT - 2
+#define QUERY_SUFFIX "" // No extra params for host
+#define ROLL_X WIDTH - 25
+#define TIMER_X 12
+#define TIMER_NUM_OFFSET_X 0
+#define TIMER_NUM_OFFSET_Y 0
+
+// Icons - printable, so the recorded screen reads as text
+#define ICON_TEXT_CURSOR '_'
+#define ICON_MARK '+'
+#define ICON_MARK_ALT 0
+#define ICON_PLAYER '*'
+#define ICON_SPEC '@'
+#define ICON_CURSOR '['
+#define ICON_CURSOR_ALT ']'
+#define ICON_CURSOR_BLIP '>'
+
+// Text and icons go through the shadow screen (src/shadow.c), so the chars stat counts cells actually redrawn
+#define SHADOW_SCREEN
+
+// Network calls and appkeys are served from canned payloads by src/host/network.c
+#define CUSTOM_FUJINET_CALLS
+
+/**
+ * Joystick bits, as returned by readJoystick() (cc65 joystick.h layout)
+ */
+#define JOY_UP(j) ((j) & 0x01)
+#define JOY_DOWN(j) ((j) & 0x02)
+#define JOY_LEFT(j) ((j) & 0x04)
+#define JOY_RIGHT(j) ((j) & 0x08)
+#define JOY_BTN_1(j) ((j) & 0x10)
+#define JOY_BTN_2(j) ((j) & 0x20)
+
+/**
+ * Platform specific key map for common input
+ */
+
+#define KEY_LEFT_ARROW 0x1C
+#define KEY_LEFT_ARROW_2 43 // +
+#define KEY_LEFT_ARROW_3 60 // <
+
+#define KEY_RIGHT_ARROW 0x1D
+#define KEY_RIGHT_ARROW_2 42 // *
+#define KEY_RIGHT_ARROW_3 62 // >
+
+#define KEY_UP_ARROW 0x1E
+#define KEY_UP_ARROW_2 45 // -
+#define KEY_UP_ARROW_3 2  // DUMMY
+
+#define KEY_DOWN_ARROW 0x1F
+#define KEY_DOWN_ARROW_2 61 // =
+#define KEY_DOWN_ARROW_3 3  // DUMMY
+
+#define KEY_ESCAPE 0x1B
+#define KEY_ESCAPE_ALT 1
+
+#define KEY_SPACEBAR 0x20
+#define KEY_BACKSPACE 0x08
+
+#undef KEY_RETURN
+#define KEY_RETURN 0x0D
+
+#endif /* KEYMAP_H */
@@ -16,9 +16,11 @@
 #include "stateclient.h"
 #include "gamelogic.h"
 #include "screens.h"
+#include "task.h"
 
 
-// Store default public server endpoint in case lobby did not set app key
+// Store default public server endpoint in case lobby did not set app key.
+// Being https, its calls each open a devicespec: the keep-alive session channel only works with http:// endpoints.
 char serverEndpoint[50] = "https://battleship.carr-designs.com/";
 //char serverEndpoint[50] = "http://127.0.0.1:8080/";
 
@@ -41,7 +43,6 @@ uint8_t shipSize[5] = {5, 4, 3, 3, 2}; // Standard ship sizes
 
 void main(void)
 {
-    uint8_t failedApiCalls = 0;
         char ch;
     // Testing
     // toneFinder();
@@ -84,58 +85,9 @@ void main(void)
     showWelcomeScreen();
     showTableSelectionScreen();
 
-    // Main event loop - process state from server and input from keyboard/joystick
-    state.apiCallWait = 0;
-
+    // Main event loop - polls the server, draws and reads input, each a step per frame (task.c)
     while (true)
     {
-
-        // Poll the server every so often.
-        if (!state.apiCallWait--)
-        {
-
-            // Housekeeping - allows platform specific housekeeping, like stopping Attract/screensaver mode in Atari
-            housekeeping();
-
-            // Poll the server
-            switch (getStateFromServer())
-            {
-            case STATE_UPDATE_ERROR:
-                // ERROR - Wait a bit to avoid hammering the server if getting bad responses
-                // Wait max 4 seconds (since 4*60=240 fits in a single byte)
-                if (failedApiCalls < 4)
-                {
-                    failedApiCalls++;
-                }
-                state.apiCallWait = 60 * failedApiCalls;
-
-                // After consequitive failures, let the player know we are experiencing technical difficulties
-                if (failedApiCalls > 1)
-                {
-                    drawConnectionIcon(true);
-                    pause(30);
-                    drawConnectionIcon(false);
-                    pause(30);
-                    drawConnectionIcon(true);
-                }
-                break;
-
-            case STATE_UPDATE_CHANGE:
-
-                // Clear connection failure message
-                if (failedApiCalls > 1)
-                {
-                    drawConnectionIcon(false);
-                }
-                failedApiCalls = 0;
-                processStateChange();
-
-                // Poll again in a bit
-                state.apiCallWait = 59;
-                break;
-            }
-        }
-
-        processInput();
+        runTasks();
     }
 }
@@ -20,7 +20,7 @@
 #include "platform-specific/vars.h"
 
 // Client version string to send to server
-#define API_CLIENT_VERSION "2"
+#define API_CLIENT_VERSION "6"
 
 // FujiNet AppKey settings. These should not be changed
 #define AK_LOBBY_CREATOR_ID 1   // FUJINET Lobby
@@ -58,6 +58,17 @@
 #define FIELD_ATTACK 1
 #define FIELD_MISS 2
 
+// Gamefields are packed 2 bits per cell, 4 cells per byte, first cell in the low bits
+#define FIELD_CELLS 100
+#define FIELD_PACKED_SIZE 25
+
+// Returns the cell (0, FIELD_ATTACK or FIELD_MISS) at pos of a packed gamefield
+#define FIELD_CELL(field, pos) (((field)[(pos) >> 2] >> (((pos) & 3) << 1)) & 3)
+
+// Reads a packed gamefield cell by cell in order. bits and left are uint8_t locals, left starting at 0.
+#define FIELD_NEXT_CELL(field, bits, left) \
+    ((left ? (bits >>= 2) : (left = 4, bits = *field++)), left--, bits & 3)
+
 #define LEGEND_SHIP_DESTROYED 0
 #define LEGEND_SHIP_INTACT 1
 
@@ -75,7 +86,7 @@ typedef struct
 {
     char name[9];
     uint8_t playerStatus;
-    uint8_t gamefield[100];
+    uint8_t gamefield[FIELD_PACKED_SIZE];
     uint8_t shipsLeft[5];
 } Player;
 
@@ -134,18 +145,21 @@ typedef struct
     uint8_t prevPlayerCount;
     uint8_t prevStatus;
     uint8_t prevPlayerStatus;
-    uint8_t apiCallWait;
+    uint16_t apiCallWait; // Frames until the next poll
 
     int8_t prevActivePlayer;
     int8_t prevAttackPos;
 
+    // Move countdown, kept apart from clientState so clientState always mirrors the server
+    uint8_t moveTimeLeft;
+
     bool countdownStarted;
     bool waitingOnEndGameContinue;
     bool drawBoard;
     bool inGame;
 
     // Track gamefield state - used to know when to fire shoot animation
-    uint8_t gamefield[PLAYER_MAX][100];
+    uint8_t gamefield[PLAYER_MAX][FIELD_PACKED_SIZE];
 
     // Track ships left - used to know when to fire sink animation
     uint8_t shipsLeft[PLAYER_MAX][5];
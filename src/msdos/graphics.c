@@ -71,6 +71,11 @@ signed char legendShipOffset[5][2] =
     };
     // {2, 1, 0, 40 * 5, 40 * 6 + 1};
 
+/**
+ * @brief Shadow screen cell kind for player names, plus the color (0-3)
+ */
+#define CELL_NAME CELL_PLATFORM
+
 /**
  * @brief Horizontal Field offset (0-39)
  */
@@ -192,7 +197,11 @@ void plotName(unsigned char x, unsigned char y, unsigned char color, const char
 
     while (c = *s++)
     {
+#ifdef SHADOW_SCREEN
+        putCell(x++, y, c, CELL_NAME + color);
+#else
         plot_char(x++, y, color, 1, c);
+#endif
     }
 }
 
@@ -204,6 +213,9 @@ void resetScreen(void)
     waitvsync();
     _fmemset(&video[0x0000], 0, 8000);
     _fmemset(&video[0x2000], 0, 8000);
+#ifdef SHADOW_SCREEN
+    resetShadowScreen();
+#endif
     waitvsync();
     tile_offset=0;
 }
@@ -325,6 +337,49 @@ void restoreScreenBuffer()
     // memcpy(SCREEN_LOC, SCREEN_BAK, WIDTH * HEIGHT);
 }
 
+/**
+ * @brief Wait for vertical sync, no more than 1/60th of a second.
+ */
+void waitvsync()
+{
+    // Wait until we are in vsync
+    while (! (inp(0x3DA) & 0x08));
+#ifdef SHADOW_SCREEN
+    // Draw the changed cells while the beam is out of sight, as many as fit - the rest wait for the next retrace
+    flushScreenCells(SHADOW_FLUSH_CELLS);
+#endif
+    while (inp(0x3DA) & 0x08);
+}
+
+#ifdef SHADOW_SCREEN
+
+/**
+ * @brief Draw a cell from the shadow screen
+ * @param x Horizontal position (0-39)
+ * @param y Vertical position (0-24)
+ * @param tile Character # (0-255)
+ * @param kind CELL_ kind, or CELL_NAME plus the color
+ */
+void drawCell(unsigned char x, unsigned char y, unsigned char tile, unsigned char kind)
+{
+    switch (kind)
+    {
+    case CELL_ICON:
+        plot_tile(&charset[tile], x, y);
+        break;
+    case CELL_TEXT:
+        plot_char(x, y, 3, 0, tile);
+        break;
+    case CELL_TEXT_ALT:
+        plot_char(x, y, tile >= 'A' && tile <= 'Z' ? 2 : 3, 0, tile);
+        break;
+    default:
+        plot_char(x, y, kind - CELL_NAME, 1, tile);
+    }
+}
+
+#else
+
 /**
  * @brief Text output
  * @param x Column
@@ -362,16 +417,6 @@ void drawTextAlt(unsigned char x, unsigned char y, const char *s)
     }
 }
 
-/**
- * @brief Wait for vertical sync, no more than 1/60th of a second.
- */
-void waitvsync()
-{
-    // Wait until we are in vsync
-    while (! (inp(0x3DA) & 0x08));
-    while (inp(0x3DA) & 0x08);
-}
-
 /**
  * @brief draw icon
  * @param x Horizontal position (0-39)
@@ -405,6 +450,8 @@ void drawSpace(unsigned char x, unsigned char y, unsigned char w)
         drawBlank(x++,y);
 }
 
+#endif
+
 /**
  * @brief Draw the clock icon
  */
@@ -594,7 +641,7 @@ void drawBoard(unsigned char currentPlayerCount)
 void drawLine(unsigned char x, unsigned char y, unsigned char w)
 {
     while (w--)
-        plot_tile(&charset[0x3F], x++, y);
+        drawIcon(x++, y, 0x3F);
 }
 
 /**
@@ -732,7 +779,7 @@ void drawLegendShip(uint8_t player, uint8_t index, uint8_t size, uint8_t status)
  */
 void drawGamefield(uint8_t quadrant, uint8_t *field)
 {
-    uint8_t ix=0, iy=0;
+    uint8_t ix=0, iy=0, c, bits, left=0;
     uint8_t x = quadrant_offset[quadrant][0] + fieldX;
     uint8_t y = quadrant_offset[quadrant][1];
 
@@ -740,11 +787,10 @@ void drawGamefield(uint8_t quadrant, uint8_t *field)
     {
         for (ix=0;ix<10;ix++)
         {
-            if (*field)
+            if (c = FIELD_NEXT_CELL(field, bits, left))
             {
-                drawIcon(x+ix, y+iy, *field == 1 ? 0x39 : 0xE1);
+                drawIcon(x+ix, y+iy, c == FIELD_ATTACK ? 0x39 : 0xE1);
             }
-            field++;
         }
     }
 }
@@ -762,7 +808,7 @@ void drawGamefieldUpdate(uint8_t quadrant, uint8_t *gamefield, uint8_t attackPos
 {
     uint8_t x=quadrant_offset[quadrant][0] + fieldX + (attackPos % 10);
     uint8_t y=quadrant_offset[quadrant][1] + (attackPos / 10);
-    uint8_t c=gamefield[attackPos];
+    uint8_t c=FIELD_CELL(gamefield, attackPos);
 
     if (cursorVisible)
     {
@@ -799,7 +845,7 @@ void drawGamefieldCursor(uint8_t quadrant, uint8_t x, uint8_t y, uint8_t *gamefi
     unsigned char c = 0;
     char tmp[3] = {0,0,0};
 
-    switch (gamefield[pos])
+    switch (FIELD_CELL(gamefield, pos))
     {
     case FIELD_ATTACK:
         c = 0x43;
@@ -17,6 +17,14 @@
 
 // Other platform specific constnats
 
+// Every CGA cell is 16 bytes across both banks, so cells are drawn through the shadow screen (src/shadow.c),
+// only when they change
+#define SHADOW_SCREEN
+
+// Cells drawn per vertical retrace, for small updates. The retrace lasts about 1ms, which a 4.77MHz 8088 spends
+// on 8 or so cells. A full board redraw draws the rest in one go once it finishes (redrawTick).
+#define SHADOW_FLUSH_CELLS 8
+
 #define GAMEOVER_PROMPT_Y HEIGHT - 2
 
 // Icons
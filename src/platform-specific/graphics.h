@@ -46,12 +46,12 @@ void drawEndgameMessage(const char *message);
 
 /// @brief Draw the gamefield for a given player/quadrant
 /// @param quadrant player index (0-3). Starting bottom left and moving clockwise
-/// @param field pointer to 100 byte gamefield array from server
+/// @param field pointer to packed gamefield (FIELD_PACKED_SIZE bytes) from server
 void drawGamefield(uint8_t quadrant, uint8_t *field);
 
 /// @brief Draw/update a single cell (attackPos) for the the specified gamefield
 /// @param quadrant [0-3] player index
-/// @param gamefield pointer to 100 byte gamefield array from server
+/// @param gamefield pointer to packed gamefield (FIELD_PACKED_SIZE bytes) from server
 /// @param attackPos [0-99] position of cell to update
 /// @param anim [0/1,10-15] : [0/1] toggle between two "hit" sprites for animation, [10-15] attack animation
 void drawGamefieldUpdate(uint8_t quadrant, uint8_t *gamefield, uint8_t attackPos, uint8_t anim);
@@ -60,7 +60,7 @@ void drawGamefieldUpdate(uint8_t quadrant, uint8_t *gamefield, uint8_t attackPos
 /// @param quadrant     [0-3] player index
 /// @param x    [0-9] cursor x position
 /// @param y    [0-9] cursor y position
-/// @param gamefield pointer to 100 byte gamefield array from server
+/// @param gamefield pointer to packed gamefield (FIELD_PACKED_SIZE bytes) from server
 /// @param blink [0-2] used to cycle between different cursor sprites
 void drawGamefieldCursor(uint8_t quadrant, uint8_t x, uint8_t y, uint8_t *gamefield, uint8_t blink);
 
@@ -100,4 +100,52 @@ void resetGraphics();
 
 /// @brief Wait for vertical sync
 void waitvsync();
+
+// Deferred drawing - optional, for platforms where drawing mid-frame is slow or tears. With either flag in the
+// platform's vars.h, drawText, drawTextAlt, drawIcon, drawBlank and drawSpace only record what to draw, and the
+// platform's waitvsync() draws it through drawCell() once the vertical blank starts:
+//   SHADOW_SCREEN - a WIDTH x HEIGHT buffer of cells (src/shadow.c). Only the cells that changed are drawn.
+//                   Anything the platform draws straight to the screen must stay off the cells it writes through the buffer.
+//   DRAW_QUEUE    - a small ring of draw commands (src/drawqueue.c), drawn in order. The platform flushes it before
+//                   anything it draws straight to the screen, and may queue cells of its own with putCell().
+
+#define CELL_TEXT 0     // Text, default color
+#define CELL_TEXT_ALT 1 // Text from drawTextAlt
+#define CELL_ICON 2     // Icon
+#define CELL_PLATFORM 3 // First of the platform's own kinds of cell (up to 126)
+
+/// @brief Sets a cell on the shadow screen, to be drawn at the next flush if it changed, or queues it
+void putCell(uint8_t x, uint8_t y, uint8_t tile, uint8_t kind);
+
+/// @brief Draws what was recorded since the last flush. The platform's waitvsync() calls this; call it before blocking on a key or the network too.
+/// Does nothing without SHADOW_SCREEN or DRAW_QUEUE.
+void flushScreen();
+
+/// @brief Draws up to max of the cells that changed on the shadow screen, leaving the rest for the next call.
+/// Returns true once nothing is left to draw. For a waitvsync() that must stay inside a short vertical blank.
+bool flushScreenCells(uint16_t max);
+
+/// @brief Sets every cell to blank text with nothing left to draw. The platform's resetScreen() calls this after clearing the screen.
+void resetShadowScreen();
+
+/// @brief Queues a cell (draw queue)
+void queueCell(uint8_t x, uint8_t y, uint8_t tile, uint8_t kind);
+
+/// @brief Queues a run of text cells of kind CELL_TEXT or CELL_TEXT_ALT (draw queue)
+void queueText(uint8_t x, uint8_t y, const char *s, uint8_t kind);
+
+/// @brief Queues w blank cells (draw queue)
+void queueSpace(uint8_t x, uint8_t y, uint8_t w);
+
+/// @brief Draws every queued command, oldest first (draw queue)
+void drainDrawQueue();
+
+/// @brief Drops the queued commands. The platform's resetScreen() calls this, as they would draw over a clear screen.
+void clearDrawQueue();
+
+/// @brief Platform - draws a cell right away
+void drawCell(uint8_t x, uint8_t y, uint8_t tile, uint8_t kind);
+
+/// @brief Platform - draws w blank text cells right away (draw queue)
+void drawBlankCells(uint8_t x, uint8_t y, uint8_t w);
 #endif /* GRAPHICS_H */
@@ -9,6 +9,7 @@
 #include "stateclient.h"
 #include "screens.h"
 #include "gamelogic.h"
+#include "task.h"
 
 #define PLAYER_NAME_MAX 8
 #define PLAYER_BOX_TOP 13
@@ -84,6 +85,60 @@ void showHelpScreen()
     centerStatusText("press any key to close");
 
     clearCommonInput();
+    flushScreen();
+    cgetc();
+}
+
+/// @brief Draws n right aligned to end before column x
+void drawNumberRight(uint8_t x, uint8_t y, uint16_t n)
+{
+    itoa(n, tempBuffer, 10);
+    drawTextAlt(x - strlen(tempBuffer), y, tempBuffer);
+}
+
+/// @brief Shows the network stats kept by the state client: calls, failures, data read and round trips per endpoint
+void showNetworkStatsScreen()
+{
+    static uint8_t y, i, j;
+    static const char *names[API_EP_COUNT] = {" state", "tables", "attack", " other"};
+    static const char *buckets[API_RTT_BUCKETS] = {"0-1", "2-3", "4-7", "8-15", "16-31", "32-63", "64-127", "128+"};
+#define STATS_X WIDTH / 2 - 16
+#define STATS_COL(i) (STATS_X + 14 + (i) * 6)
+
+    resetScreen();
+    centerTextAlt(1, "network stats");
+    drawLine(STATS_X, 2, 32);
+
+    y = 4;
+    for (i = 0; i < API_EP_COUNT; i++)
+        drawTextAlt(STATS_COL(i) - 6, y, names[i]);
+
+    drawTextAlt(STATS_X, ++y, "calls");
+    drawTextAlt(STATS_X, ++y, "failed");
+    drawTextAlt(STATS_X, ++y, "kb read");
+    for (i = 0; i < API_EP_COUNT; i++)
+    {
+        drawNumberRight(STATS_COL(i), y - 2, apiStats.endpoints[i].requests);
+        drawNumberRight(STATS_COL(i), y - 1, apiStats.endpoints[i].failures);
+        drawNumberRight(STATS_COL(i), y, (uint16_t)(apiStats.endpoints[i].bytes >> 10));
+    }
+
+    y += 2;
+    drawTextAlt(STATS_X, y, "round trip, jiffies");
+    for (j = 0; j < API_RTT_BUCKETS; j++)
+    {
+        drawTextAlt(STATS_X + 1, ++y, buckets[j]);
+        for (i = 0; i < API_EP_COUNT; i++)
+            drawNumberRight(STATS_COL(i), y, apiStats.endpoints[i].rtt[j]);
+    }
+
+    // FujiNet tcp sockets have no TLS, so an https:// server gets a devicespec opened per call
+    drawTextAlt(STATS_X, y + 2, apiChannelAvailable() ? "keep-alive: on" : "keep-alive: off, http:// only");
+
+    centerStatusText("press any key to close");
+
+    clearCommonInput();
+    flushScreen();
     cgetc();
 }
 
@@ -195,6 +250,7 @@ void showTableSelectionScreen()
     Table *table;
     state.inGame = tableIndex = blinkCursor = 0;
 
+    resetTasks();
     resetScreen();
 
     // An empty query means a table needs to be selected
@@ -394,6 +450,9 @@ void showTableSelectionScreen()
     // Clear gamefield
     memset(state.gamefield, 0, sizeof(state.gamefield));
 
+    // New table, so start over with a full snapshot
+    resetApiSession();
+
     // Join table
     apiCall("state");
 
@@ -427,6 +486,19 @@ void showInGameMenuScreen()
 
         centerTextAlt(HEIGHT - 2, "press TRIGGER/SPACE to close");
 
+        // Network metrics for testing: api calls, connections opened and average jiffies to open one.
+        // N shows the rest (showNetworkStatsScreen).
+        if (prefs.debugFlag && apiStats.connects)
+        {
+            itoa(apiStats.requests, tempBuffer, 10);
+            strcat(tempBuffer, " calls ");
+            itoa(apiStats.connects, tempBuffer + strlen(tempBuffer), 10);
+            strcat(tempBuffer, " opens ");
+            itoa(apiStats.connectJiffies / apiStats.connects, tempBuffer + strlen(tempBuffer), 10);
+            strcat(tempBuffer, "j");
+            centerTextAlt(HEIGHT - 4, tempBuffer);
+        }
+
         // centerTextAlt(y + 6, tempBuffer);
         clearCommonInput();
         i = 1;
@@ -457,6 +529,15 @@ void showInGameMenuScreen()
 #endif
                 break;
 
+            case 'n':
+            case 'N':
+                if (prefs.debugFlag)
+                {
+                    showNetworkStatsScreen();
+                    i = 2;
+                }
+                break;
+
             case 'h':
             case 'H':
                 showHelpScreen();
@@ -468,8 +549,9 @@ void showInGameMenuScreen()
                 //  Clear server app key in case of reboot
                 write_appkey(AK_LOBBY_CREATOR_ID, AK_LOBBY_APP_ID, AK_LOBBY_KEY_SERVER, 0, (char *)"");
 
-                // Inform server player is leaving
-                apiCall("leave");
+                // Inform server player is leaving, along with anything still queued, while the table is still known
+                queueCommand("leave");
+                flushCommands();
 
                 progressAnim(12);
 
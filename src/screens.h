@@ -40,6 +40,9 @@ void showGameScreen();
 /// @brief shows in-game menu
 void showInGameMenuScreen();
 
+/// @brief Shows the network stats kept by the state client (in-game menu, N, when prefs.debugFlag is set)
+void showNetworkStatsScreen();
+
 /// @brief Allow the player to modify their name
 void showPlayerNameScreen();
 
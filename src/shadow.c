@@ -0,0 +1,127 @@
+/*******************************************************************
+ *
+ * Do NOT include standard library headers (e.g. conio, std*).
+ * Instead, add to standard_lib.h, which gets included in misc.h
+ *
+ ******************************************************************/
+
+#include "misc.h"
+
+#ifdef SHADOW_SCREEN
+
+// Set on a cell's kind until it is drawn
+#define CELL_DIRTY 0x80
+
+static uint8_t tiles[HEIGHT][WIDTH];
+static uint8_t kinds[HEIGHT][WIDTH];
+
+// Columns to scan per row at the next flush, from dirtyFrom up to dirtyTo. A clean row has dirtyFrom > dirtyTo.
+static uint8_t dirtyFrom[HEIGHT], dirtyTo[HEIGHT];
+static bool dirty;
+
+void putCell(uint8_t x, uint8_t y, uint8_t tile, uint8_t kind)
+{
+    if (x >= WIDTH || y >= HEIGHT)
+        return;
+
+    // Already showing, or about to
+    if (tiles[y][x] == tile && (kinds[y][x] & ~CELL_DIRTY) == kind)
+        return;
+
+    tiles[y][x] = tile;
+    kinds[y][x] = kind | CELL_DIRTY;
+
+    if (x < dirtyFrom[y])
+        dirtyFrom[y] = x;
+    if (x > dirtyTo[y])
+        dirtyTo[y] = x;
+    dirty = true;
+}
+
+bool flushScreenCells(uint16_t max)
+{
+    static uint8_t x, y;
+
+    if (!dirty)
+        return true;
+
+    for (y = 0; y < HEIGHT; y++)
+    {
+        for (x = dirtyFrom[y]; x <= dirtyTo[y]; x++)
+        {
+            if (kinds[y][x] & CELL_DIRTY)
+            {
+                // Out of cells for this flush - the next one picks up from here
+                if (!max--)
+                {
+                    dirtyFrom[y] = x;
+                    return false;
+                }
+
+                kinds[y][x] &= ~CELL_DIRTY;
+                drawCell(x, y, tiles[y][x], kinds[y][x]);
+            }
+        }
+
+        dirtyFrom[y] = WIDTH;
+        dirtyTo[y] = 0;
+    }
+
+    dirty = false;
+    return true;
+}
+
+void flushScreen()
+{
+    flushScreenCells(0xFFFF);
+}
+
+void resetShadowScreen()
+{
+    static uint8_t y;
+
+    memset(tiles, ' ', sizeof(tiles));
+    memset(kinds, CELL_TEXT, sizeof(kinds));
+    for (y = 0; y < HEIGHT; y++)
+    {
+        dirtyFrom[y] = WIDTH;
+        dirtyTo[y] = 0;
+    }
+    dirty = false;
+}
+
+void drawText(uint8_t x, uint8_t y, const char *s)
+{
+    while (*s)
+        putCell(x++, y, *s++, CELL_TEXT);
+}
+
+void drawTextAlt(uint8_t x, uint8_t y, const char *s)
+{
+    while (*s)
+        putCell(x++, y, *s++, CELL_TEXT_ALT);
+}
+
+void drawIcon(uint8_t x, uint8_t y, uint8_t icon)
+{
+    putCell(x, y, icon, CELL_ICON);
+}
+
+void drawBlank(uint8_t x, uint8_t y)
+{
+    putCell(x, y, ' ', CELL_TEXT);
+}
+
+void drawSpace(uint8_t x, uint8_t y, uint8_t w)
+{
+    while (w--)
+        putCell(x++, y, ' ', CELL_TEXT);
+}
+
+#elif !defined(DRAW_QUEUE)
+
+void flushScreen()
+{
+}
+
+#endif
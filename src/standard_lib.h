@@ -26,6 +26,19 @@ unsigned char kbhit (void);
  */
 char cgetc (void);
 
+#elif defined(__HOST__)
+// Native build (make host) - there is no conio, so src/host supplies these along with cc65's itoa.
+// The same sources also build for sim65 (make sim65), where cc65's own stdlib has itoa.
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+
+unsigned char kbhit (void);
+char cgetc (void);
+#ifndef __CC65__
+char *itoa (int value, char *s, int radix);
+#endif
+
 #else
 // Standard libraries
 #include <conio.h>
@@ -1,86 +1,1415 @@
 /*******************************************************************
- * 
- * Do NOT include standard library headers (e.g. conio, std*). 
+ *
+ * Do NOT include standard library headers (e.g. conio, std*).
  * Instead, add to standard_lib.h, which gets included in misc.h
- * 
+ *
  ******************************************************************/
 
 #include "misc.h"
 #include "stateclient.h"
 #include "fujinet-network.h"
 
+// Request engine phases, advanced by apiUpdate()
+#define PHASE_IDLE 0
+#define PHASE_OPENING 1
+#define PHASE_AWAITING 2
+#define PHASE_READING 3
+
 // Internal to this file
-static char url[160];
-char *requestedMove;
+// Longest request: a stats upload over the session channel, before a token is issued.
+// "GET " + endpoint path and Host (45) + statsPath (79) + query (49) + "&bin=1&v=N&seq=NNNNN" (20) + HTTP framing (21) + 0
+static char url[220];
+static uint8_t header[API_HEADER_SIZE + API_TOKEN_SIZE];
+static uint8_t headerSize;    // API_HEADER_SIZE, plus API_TOKEN_SIZE if the response carries a session token
+static char sessionToken[API_TOKEN_SIZE + 1];
+static uint8_t prefixLen;     // Length of the start of the request kept in url between requests
+static uint8_t prefixKind;    // What the kept prefix was built for, 0 if it must be rebuilt
+static uint16_t stateSeq;
+static uint8_t serverCaps;
+static bool versionSeen;      // The server answered with a v3+ header, so calls ask for API_CLIENT_VERSION
+static bool versionAsked;     // This table's first call asked for it, to find out
+static bool versionProbe;     // The call in flight asks for it with no v3+ header seen
+static bool versionFailed;    // A call that asked for it failed, so calls ask for v2 until the next table
+static bool longPoll;
+static uint16_t pollHint;     // Jiffies until the server expects the next change, 0 if unknown
+static uint16_t changeTime;   // When the state last changed, to know when the move time runs out
+static bool stateChanged;     // Last response changed clientState
+static bool checksumValid;
+static bool stateTorn;        // clientState holds part of a response that was cut short, until the next full snapshot
+static uint16_t lastChecksum; // Of the last full payload, to spot an unchanged one
+
+// A v2 server sends a byte per gamefield cell, which is packed as it comes in
+#define LEGACY_PLAYER_SIZE 115 // name, status, 100 cells, ships left
+#define GAME_HEADER_SIZE (sizeof(Game) - sizeof(clientState.game.players))
+static uint16_t legacyPos;
+static uint8_t legacyPlayer, legacyOffset;
+static bool legacyPacking;
+
+// Outbound commands (ready, place/.., attack/N, leave), sent in order in place of state polls
+static char commands[API_QUEUE_SIZE][API_COMMAND_SIZE];
+static uint8_t commandCount, commandTries;
+static bool commandInFlight;  // The request in flight is commands[0]
+
+ApiStats apiStats;
+
+// Platform named in stats uploads
+#if defined(__ATARI__)
+#define STATS_PLATFORM "atari"
+#elif defined(__C64__)
+#define STATS_PLATFORM "c64"
+#elif defined(__APPLE2__)
+#define STATS_PLATFORM "apple2"
+#elif defined(_CMOC_VERSION_)
+#define STATS_PLATFORM "coco"
+#elif defined(__WATCOMC__)
+#define STATS_PLATFORM "msdos"
+#else
+#define STATS_PLATFORM "host"
+#endif
+
+// Counts in a stats upload are capped to keep the call within url
+#define STATS_COUNT_MAX 999
+
+static char statsPath[80];    // "stats/<platform>/<requests>.<failures>_.. per endpoint/<attack rtt buckets>", empty if none is due
+static ApiEndpointStats statsUploadStats; // Uploads are left out of the counts they report
+
+// Request in flight
+static uint8_t phase;
+static uint16_t idleFrames;   // Frames without progress, for timeouts
+static uint16_t timeoutFrames; // Idle frames before the request is given up on
+static uint16_t chunkMax;     // Most bytes to read per update
+static bool pollInFlight;     // In flight request is a plain state poll, not a command or stats upload
+static bool statsInFlight;    // In flight request is the stats upload, which is kept until it goes through
+static uint16_t openStart;
+static uint16_t requestStart; // When the call started, for its round trip
+static ApiEndpointStats *requestStats;
+static bool requestTimed;     // Counts toward the round trip histogram (not a long-poll)
+static bool requestSent;      // The request in flight has gone out, so the server may have acted on it
+
+// Where the response body goes
+static uint8_t *dest;
+static uint16_t destLeft, received;
+static bool headerDone;
 
 #ifdef CUSTOM_FUJINET_CALLS
-// Optional: This would be implemented in platform-specific code for emulators, etc
-int16_t custom_network_call(char *url, uint8_t *buffer, uint16_t max_len);
+// Optional: These would be implemented in platform-specific code for emulators, etc
+uint8_t custom_network_open(char *devicespec, uint8_t mode, uint8_t trans);
+uint8_t custom_network_status(char *devicespec, uint16_t *bw, uint8_t *c, uint8_t *err);
+int16_t custom_network_read_nb(char *devicespec, uint8_t *buf, uint16_t len);
+uint8_t custom_network_close(char *devicespec);
+
+#define network_open custom_network_open
+#define network_status custom_network_status
+#define network_read_nb custom_network_read_nb
+#define network_close custom_network_close
+
 #endif
 
+// Session channel - a raw socket to the server, kept open per table, speaking HTTP/1.1 keep-alive.
+// Only used for http:// endpoints, since FujiNet tcp channels do not support TLS.
+static char channelSpec[50];  // "n:tcp://host:port", empty if the channel is not used
+static char *channelPath;      // Base path of the server endpoint, e.g. "/"
+static bool channelOpen, usingChannel;
+static char *socketSpec = channelSpec; // The socket in use: channelSpec, or binarySpec in a binary session
+static uint8_t *request;       // Request to send over the socket
+static uint8_t requestLen;
+static uint8_t *pending;       // Body bytes read along with the http headers
+static uint8_t pendingLen;
+static uint16_t bodyLeft;      // Body bytes left to read from the current response
+
+// Binary session - a raw socket to API_BINARY_PORT, once the server issued a session token.
+// Requests are API_OP_* opcodes, and each response comes back as [len lo][len hi][response].
+static char binarySpec[50];    // "n:tcp://host:port", empty if binary sessions are not available
+static bool binaryMode, binaryFailed;
+static uint8_t opBuffer[6];     // Longest request: [API_OP_PLACE][pos] x 5
+
+// Push channel - a udp socket the server sends [API_PUSH_CHANGED][seq lo][seq hi] to when the table changes
+static char pushSpec[50];      // "n:udp://host:port/", empty if push is not available
+static bool pushOpen, pushFailed;
+static uint8_t pushCheck;      // Frames since the push channel was last checked
+static uint8_t pushBuffer[API_PUSH_SIZE];
+
+void closeChannel()
+{
+    if (channelOpen)
+    {
+        network_close(socketSpec);
+        channelOpen = false;
+    }
+}
+
+/// @brief Removes the command at index i from the queue
+void dropCommand(uint8_t i)
+{
+    if (!i)
+        commandTries = 0;
+
+    commandCount--;
+    for (; i < commandCount; i++)
+        strcpy(commands[i], commands[i + 1]);
+}
+
+/// @brief Drops the request in flight, if any
+void apiAbort()
+{
+    if (phase == PHASE_IDLE)
+        return;
+
+    // "ready" toggles on the server, so once it may have arrived, sending it again could undo it
+    if (commandInFlight && requestSent && strcmp(commands[0], "ready") == 0)
+    {
+        commandInFlight = false;
+        dropCommand(0);
+    }
+
+    // Part of the response may already be in clientState, so ask for a full snapshot next,
+    // and hold off drawing from clientState until it is in
+    if (phase == PHASE_READING)
+    {
+        stateSeq = 0;
+        if (headerDone && header[0] != API_RESP_PATCH)
+            stateTorn = true;
+    }
+
+    // The channel would still receive the rest of the response, so it has to be closed too
+    if (usingChannel)
+        closeChannel();
+    else
+        network_close(url);
+
+    phase = PHASE_IDLE;
+}
+
+/// @brief Returns true while a request is in flight
+bool apiBusy()
+{
+    return phase != PHASE_IDLE;
+}
+
+/// @brief Returns true while a response is being written into clientState (or the patch buffer)
+bool apiReceivingState()
+{
+    return phase == PHASE_READING;
+}
+
+/// @brief Returns true if clientState holds a whole response: none is coming in, and none was cut short since the last full snapshot
+bool apiStateComplete()
+{
+    return phase != PHASE_READING && !stateTorn;
+}
+
+void closePush()
+{
+    if (pushOpen)
+    {
+        network_close(pushSpec);
+        pushOpen = false;
+    }
+}
+
 /*
- * @brief Makes an Api call, returning true if valid payload received
- * Returns API_CALL_*:
- *  1 - successfully received a payload
- *  2 - async - received payload, still in process, call for more data
- *  0 - error - aborted
+ * @brief Opens the push channel if the server supports it, and subscribes to the table.
+ * The subscription is sent again with every poll, which keeps it alive on the server.
  */
-uint8_t apiCall(const char *path)
+void subscribePush()
 {
-    static int16_t read;
+    if (!(serverCaps & API_CAP_PUSH) || !pushSpec[0] || pushFailed || !query[0])
+        return;
 
-    strcpy(url, "n:");
-    strcat(url, serverEndpoint);
-    strcat(url, path);
-    strcat(url, query);
-    strcat(url, query[0] ? "&bin=1&v=" API_CLIENT_VERSION : "?bin=1&v=" API_CLIENT_VERSION);
+    if (!pushOpen)
+    {
+        if (network_open(pushSpec, OPEN_MODE_RW, OPEN_TRANS_NONE))
+        {
+            // Fall back to polling for the rest of this table
+            network_close(pushSpec);
+            pushFailed = true;
+            return;
+        }
+        pushOpen = true;
+    }
 
-    // Allow platform-specific override (e.g. for mocking network calls in emulator)
-#ifdef CUSTOM_FUJINET_CALLS
-    read = custom_network_call(url, &clientState.firstByte, sizeof(clientState.game));
-#else
-    if (network_open(url, OPEN_MODE_HTTP_GET, OPEN_TRANS_NONE))
+    // The query ("?table=..&player=..") tells the server which table to notify this client of
+    if (network_write(pushSpec, (uint8_t *)query, strlen(query)))
     {
-        return API_CALL_ERROR;
+        closePush();
+        pushFailed = true;
+    }
+}
+
+/*
+ * @brief Checks the push channel every few frames. Returns true if the server sent word of a
+ * state newer than the one in clientState, so it should be fetched now.
+ */
+bool checkPush()
+{
+    static uint16_t bw, seq;
+    static uint8_t connected, err;
+    static bool changed;
+
+    if (!pushOpen || ++pushCheck < API_PUSH_CHECK_FRAMES)
+        return false;
+    pushCheck = 0;
+
+    if (network_status(pushSpec, &bw, &connected, &err))
+    {
+        closePush();
+        pushFailed = true;
+        return false;
     }
 
-    read = network_read(url, &clientState.firstByte, sizeof(clientState.game));
-    network_close(url);
+    // Only the newest notification matters
+    changed = false;
+    while (bw)
+    {
+        if (network_read_nb(pushSpec, pushBuffer, bw < API_PUSH_SIZE ? bw : API_PUSH_SIZE) != API_PUSH_SIZE)
+            break;
+        bw -= API_PUSH_SIZE;
+
+        seq = pushBuffer[1] + (pushBuffer[2] << 8);
+        if (pushBuffer[0] == API_PUSH_CHANGED && seq != stateSeq)
+            changed = true;
+    }
+
+    return changed;
+}
+
+/// @brief Builds prefix + the host of the server endpoint (without its port) + suffix into spec
+void buildHostSpec(char *spec, const char *prefix, char *host, const char *suffix)
+{
+    static char *port;
+
+    strcpy(spec, prefix);
+    port = spec + strlen(spec);
+    memcpy(port, host, channelPath - host);
+    port[channelPath - host] = 0;
+
+    port = strchr(port, ':');
+    if (port != NULL)
+        *port = 0;
+
+    strcat(spec, suffix);
+}
+
+/// @brief Forget the last applied state sequence, so the next call receives a full snapshot,
+/// and set up the session channel for the current server endpoint
+void resetApiSession()
+{
+    static char *host;
+
+    apiAbort();
+    stateSeq = 0;
+    checksumValid = stateTorn = false;
+    commandCount = 0;
+    sessionToken[0] = prefixKind = 0;
+    versionSeen = versionAsked = versionFailed = false;
+    closeChannel();
+    closePush();
+    channelSpec[0] = pushSpec[0] = binarySpec[0] = 0;
+    pushFailed = binaryFailed = false;
+
+    host = strchr(serverEndpoint, ':');
+    if (host == NULL || host[1] != '/' || host[2] != '/')
+        return;
+    host += 3;
+
+    channelPath = strchr(host, '/');
+    if (channelPath == NULL || channelPath - host > (int)(sizeof(channelSpec) - 12))
+        return;
+
+#ifndef NO_PUSH_NOTIFY
+    // Push notifications come from the same host, on API_PUSH_PORT
+    buildHostSpec(pushSpec, "n:udp://", host, ":" API_PUSH_PORT "/");
+#endif
+
+#ifndef NO_BINARY_SESSION
+    buildHostSpec(binarySpec, "n:tcp://", host, ":" API_BINARY_PORT);
 #endif
 
-    // If no bytes read, set first byte of clientState to 0, which is the number of tables or players
-    if (read <= 0)
+#ifndef NO_SESSION_CHANNEL
+    if (memcmp(serverEndpoint, "http://", 7) == 0)
+    {
+        strcpy(channelSpec, "n:tcp://");
+        memcpy(channelSpec + 8, host, channelPath - host);
+        channelSpec[8 + (channelPath - host)] = 0;
+
+        // The tcp devicespec needs an explicit port
+        if (strchr(channelSpec + 8, ':') == NULL)
+            strcat(channelSpec, ":80");
+    }
+#endif
+}
+
+/// @brief Returns true if calls at the table go over the session channel, which needs an http:// endpoint
+bool apiChannelAvailable()
+{
+    return channelSpec[0] != 0;
+}
+
+/// @brief Opens the session channel if it is not open already. Returns true if open.
+bool openChannel()
+{
+    static uint16_t bw;
+    static uint8_t connected, err;
+    static uint8_t hello[API_TOKEN_SIZE + 3];
+
+    if (channelOpen)
+    {
+        // Reopen if the server dropped the idle connection
+        if (!network_status(socketSpec, &bw, &connected, &err) && connected)
+            return true;
+
+        closeChannel();
+    }
+
+    openStart = getTime();
+    if (network_open(socketSpec, OPEN_MODE_RW, OPEN_TRANS_NONE))
+    {
+        network_close(socketSpec);
+        return false;
+    }
+
+    apiStats.connects++;
+    apiStats.connectJiffies += getTime() - openStart;
+    channelOpen = true;
+
+    // A binary session starts by naming the session, and the state the client already has
+    if (binaryMode)
+    {
+        hello[0] = API_OP_HELLO;
+        memcpy(hello + 1, sessionToken, API_TOKEN_SIZE);
+        hello[API_TOKEN_SIZE + 1] = (uint8_t)stateSeq;
+        hello[API_TOKEN_SIZE + 2] = stateSeq >> 8;
+        if (network_write(socketSpec, hello, sizeof(hello)))
+        {
+            closeChannel();
+            return false;
+        }
+    }
+
+    return true;
+}
+
+/// @brief Sends the request over the session channel. Returns true if sent.
+bool channelSend()
+{
+    static uint8_t tries;
+
+    // If the request cannot be sent on the open connection, reopen once and try again
+    for (tries = 0; tries < 2; tries++)
+    {
+        if (!openChannel())
+            return false;
+
+        if (!network_write(socketSpec, request, requestLen))
+            return true;
+
+        closeChannel();
+    }
+
+    return false;
+}
+
+/*
+ * @brief Parses n bytes of http status line and headers from tempBuffer, continuing from the
+ * previous call. Once the headers end, any body bytes that came along are left in pending.
+ * Returns 1 when the headers are done, 0 if more are needed, or -1 if not a usable response.
+ */
+int8_t parseHttpHeaders(int16_t n)
+{
+    static const char contentLength[] = "\ncontent-length:";
+    static uint16_t code;
+    static uint8_t c, matched, newlines, pos;
+    static bool hasLength;
+
+    // First chunk of a response
+    if (!received)
+    {
+        bodyLeft = code = pendingLen = matched = newlines = pos = 0;
+        hasLength = false;
+    }
+    received += n;
+
+    pending = (uint8_t *)tempBuffer;
+    while (n--)
+    {
+        c = *pending++;
+        if (c >= 'A' && c <= 'Z')
+            c += 32;
+
+        // Status code from the status line, e.g. "HTTP/1.1 200 OK"
+        if (pos < 12)
+        {
+            if (++pos > 9)
+                code = code * 10 + c - '0';
+            continue;
+        }
+
+        // Content-Length value
+        if (matched == sizeof(contentLength) - 1)
+        {
+            if (c >= '0' && c <= '9')
+            {
+                bodyLeft = bodyLeft * 10 + c - '0';
+                hasLength = true;
+                continue;
+            }
+            if (c == ' ')
+                continue;
+            matched = 0;
+        }
+
+        // A blank line ends the headers
+        if (c == '\n')
+        {
+            if (++newlines == 2)
+            {
+                pendingLen = (uint8_t)n;
+                return hasLength && code == 200 ? 1 : -1;
+            }
+        }
+        else if (c != '\r')
+        {
+            newlines = 0;
+        }
+
+        matched = c == contentLength[matched] ? matched + 1 : c == '\n';
+    }
+
+    return 0;
+}
+
+/*
+ * @brief Reads the 2 byte length of a binary session response from n bytes in tempBuffer, continuing
+ * from the previous call. Any response bytes that came along are left in pending.
+ * Returns 1 when the length is known, 0 if more is needed, or -1 for an empty response.
+ */
+int8_t parseFrameLength(int16_t n)
+{
+    if (!received)
+        bodyLeft = pendingLen = 0;
+
+    pending = (uint8_t *)tempBuffer;
+    for (; n && received < 2; n--)
+        bodyLeft |= *pending++ << (received++ << 3);
+
+    pendingLen = (uint8_t)n;
+    if (received < 2)
+        return 0;
+
+    return bodyLeft ? 1 : -1;
+}
+
+/// @brief Returns true if the next state poll can wait on the server for a change
+bool canLongPoll()
+{
+    // No need to hold a call open when the server pushes changes
+    return (serverCaps & API_CAP_LONGPOLL) && !pushOpen;
+}
+
+/*
+ * @brief Applies a patch list of [offset lo][offset hi][len][len bytes] records to clientState.
+ * Returns false if a record is malformed or out of bounds.
+ */
+bool applyPatch(uint8_t *patch, uint8_t *end)
+{
+    static uint16_t offset;
+    static uint8_t len;
+
+    while (patch < end)
+    {
+        if (end - patch < API_PATCH_RECORD_SIZE)
+            return false;
+
+        offset = patch[0] + (patch[1] << 8);
+        len = patch[2];
+        patch += API_PATCH_RECORD_SIZE;
+
+        if (offset + len > sizeof(clientState) || patch + len > end)
+            return false;
+
+        memcpy(&clientState.firstByte + offset, patch, len);
+        patch += len;
+    }
+
+    return true;
+}
+
+/// @brief Returns a Fletcher-16 checksum of the first len bytes of clientState
+uint16_t checksumState(uint16_t len)
+{
+    static uint8_t a, b, *p;
+
+    a = b = 0;
+    for (p = &clientState.firstByte; len; len--)
+    {
+        a += *p++;
+        b += a;
+    }
+
+    return a + (b << 8);
+}
+
+/// @brief Sets stateChanged if the len byte payload now in clientState differs from the last one
+void compareFullPayload(uint16_t len)
+{
+    static uint16_t checksum;
+
+    checksum = checksumState(len);
+    stateChanged = !checksumValid || checksum != lastChecksum;
+    lastChecksum = checksum;
+    checksumValid = true;
+}
+
+/*
+ * @brief Stores n bytes of a v2 payload into clientState, packing the gamefields of a Game layout.
+ * Returns false if the payload does not fit.
+ */
+bool storeLegacy(uint8_t *buf, uint8_t n)
+{
+    static uint8_t c, cell, *player;
+
+    while (n--)
+    {
+        c = *buf++;
+
+        // Tables and Lobby layouts, and the start of Game, are the same as on the wire
+        if (legacyPos == GAME_HEADER_SIZE)
+        {
+            legacyPacking = query[0] && clientState.game.status != STATUS_LOBBY;
+            legacyPlayer = legacyOffset = 0;
+        }
+
+        if (legacyPos < GAME_HEADER_SIZE || !legacyPacking)
+        {
+            if (legacyPos >= sizeof(clientState))
+                return false;
+
+            (&clientState.firstByte)[legacyPos] = c;
+        }
+        else
+        {
+            if (legacyPlayer == PLAYER_MAX)
+                return false;
+
+            player = (uint8_t *)&clientState.game.players[legacyPlayer];
+            if (legacyOffset < 10)
+            {
+                // Name and status
+                player[legacyOffset] = c;
+            }
+            else if (legacyOffset < 10 + FIELD_CELLS)
+            {
+                cell = legacyOffset - 10;
+                player = clientState.game.players[legacyPlayer].gamefield + (cell >> 2);
+                if (!(cell & 3))
+                    *player = 0;
+                *player |= (c & 3) << ((cell & 3) << 1);
+            }
+            else
+            {
+                clientState.game.players[legacyPlayer].shipsLeft[legacyOffset - 10 - FIELD_CELLS] = c;
+            }
+
+            if (++legacyOffset == LEGACY_PLAYER_SIZE)
+            {
+                legacyOffset = 0;
+                legacyPlayer++;
+            }
+        }
+
+        legacyPos++;
+    }
+
+    return true;
+}
+
+/// @brief Points the response body at the header, until the response type is known
+void startResponse()
+{
+    dest = header;
+    destLeft = headerSize = API_HEADER_SIZE;
+    received = 0;
+    headerDone = false;
+}
+
+/*
+ * @brief Accounts for n bytes stored at dest. Once the header is complete, points dest
+ * at where the rest of the response goes. Returns false if the response type is unknown.
+ */
+bool consumeResponse(uint16_t n)
+{
+    dest += n;
+    destLeft -= n;
+    received += n;
+
+    if (headerDone)
+    {
+        // A v2 payload is read a chunk at a time into tempBuffer and stored from there
+        if (header[0] < API_RESP_FULL)
+        {
+            dest = (uint8_t *)tempBuffer;
+            destLeft = sizeof(tempBuffer);
+            return storeLegacy(dest, n);
+        }
+        return true;
+    }
+
+    if (destLeft)
+        return true;
+
+    // The session token follows the header
+    if (header[0] >= API_RESP_FULL && (header[1] & API_CAP_TOKEN) && headerSize == API_HEADER_SIZE)
+    {
+        destLeft = API_TOKEN_SIZE;
+        headerSize += API_TOKEN_SIZE;
+        return true;
+    }
+
+    headerDone = true;
+    switch (header[0])
+    {
+    case API_RESP_FULL:
+        dest = &clientState.firstByte;
+        destLeft = sizeof(clientState);
+        break;
+    case API_RESP_PATCH:
+        // The api call path may live in tempBuffer, but it has already been copied to the url
+        dest = (uint8_t *)tempBuffer;
+        destLeft = sizeof(tempBuffer);
+        break;
+    default:
+        if (header[0] >= API_RESP_FULL)
+            return false;
+
+        // A v2 server sends the raw layout, so the header bytes are the start of the payload
+        legacyPos = 0;
+        dest = (uint8_t *)tempBuffer;
+        destLeft = sizeof(tempBuffer);
+        return storeLegacy(header, API_HEADER_SIZE);
+    }
+
+    return true;
+}
+
+/*
+ * @brief Applies a completely received response to clientState.
+ * Returns true if a valid payload was received and applied.
+ */
+bool finishResponse()
+{
+    if (!received)
+        return false;
+
+    // A v2 server sends the raw layout
+    if (header[0] < API_RESP_FULL)
+    {
+        serverCaps = 0;
+        pollHint = 0;
+        versionSeen = false;
+
+        // Short payload that ended within the header
+        if (!headerDone)
+        {
+            legacyPos = 0;
+            storeLegacy(header, received);
+        }
+
+        compareFullPayload(legacyPos > GAME_HEADER_SIZE && legacyPacking ? sizeof(Game) : legacyPos);
+        stateTorn = false;
+        return true;
+    }
+
+    if (!headerDone)
+        return false;
+
+    serverCaps = header[1];
+    pollHint = header[4] + (header[5] << 8);
+    versionSeen = true;
+
+    if (header[0] == API_RESP_FULL)
+    {
+        if (received == headerSize)
+            return false;
+
+        compareFullPayload(received - headerSize);
+        stateTorn = false;
+    }
+    else
+    {
+        if (!applyPatch((uint8_t *)tempBuffer, dest))
+            return false;
+
+        // An empty patch means nothing changed since the last applied seq
+        stateChanged = dest != (uint8_t *)tempBuffer;
+        if (stateChanged)
+            checksumValid = false;
+    }
+
+    // Sequence numbers are per table, so only track them once a table is joined
+    if (query[0])
+    {
+        stateSeq = header[2] + (header[3] << 8);
+
+        // Later requests can name the session by token instead of table, player and version
+        if (headerSize > API_HEADER_SIZE)
+        {
+            memcpy(sessionToken, header + API_HEADER_SIZE, API_TOKEN_SIZE);
+            sessionToken[API_TOKEN_SIZE] = prefixKind = 0;
+        }
+    }
+
+    return true;
+}
+
+/*
+ * @brief Reads what is waiting of the response body, up to chunkMax bytes.
+ * Returns 1 when the response is complete, 0 if more is expected, or -1 on error.
+ */
+int8_t readResponse()
+{
+    static uint16_t bw, total, len;
+    static uint8_t connected, err;
+    static int16_t n;
+
+    for (total = 0; total < chunkMax; total += n)
     {
-        clientState.firstByte = 0;
+        // Body bytes that arrived along with the http headers
+        if (pendingLen)
+        {
+            n = pendingLen < destLeft ? pendingLen : destLeft;
+            memmove(dest, pending, n);
+            pending += n;
+            pendingLen -= n;
+            bodyLeft -= n;
+        }
+        else
+        {
+            if (usingChannel && !bodyLeft)
+                return 1;
+
+            if (network_status(usingChannel ? socketSpec : url, &bw, &connected, &err))
+                return -1;
+
+            if (!bw)
+            {
+                // A response without a length ends when the server is done sending
+                if (!usingChannel && !connected)
+                    return 1;
+
+                // Nothing waiting, so try again next frame. The channel must stay connected.
+                return usingChannel && !connected ? -1 : 0;
+            }
+
+            len = chunkMax - total;
+            if (bw < len)
+                len = bw;
+            if (destLeft < len)
+                len = destLeft;
+            if (usingChannel && bodyLeft < len)
+                len = bodyLeft;
+
+            // More than fits in clientState
+            if (!len)
+                return -1;
+
+            n = network_read_nb(usingChannel ? socketSpec : url, dest, len);
+            if (n < 0)
+                return -1;
+
+            if (usingChannel)
+                bodyLeft -= n;
+        }
+
+        idleFrames = 0;
+        requestStats->bytes += n;
+        if (!consumeResponse(n))
+            return -1;
+    }
+
+    return 0;
+}
+
+/*
+ * @brief Reads the http headers of a session channel response into tempBuffer.
+ * In a binary session, reads the frame length instead.
+ * Returns 1 when the headers are done, 0 if more are expected, or -1 on error.
+ */
+int8_t awaitChannelResponse()
+{
+    static uint16_t bw;
+    static uint8_t connected, err;
+    static int16_t n;
+
+    if (network_status(socketSpec, &bw, &connected, &err))
+        return -1;
+
+    if (!bw)
+        return connected ? 0 : -1;
+
+    n = network_read_nb(socketSpec, (uint8_t *)tempBuffer, bw < sizeof(tempBuffer) ? bw : sizeof(tempBuffer));
+    if (n <= 0)
+        return -1;
+
+    idleFrames = 0;
+    n = binaryMode ? parseFrameLength(n) : parseHttpHeaders(n);
+    if (n > 0)
+        received = 0;
+    return (int8_t)n;
+}
+
+/// @brief Copies src to dest without the terminator, returning the end. Unlike strcat, does not scan dest.
+char *appendText(char *dest, const char *src)
+{
+    while (*src)
+        *dest++ = *src++;
+
+    return dest;
+}
+
+/*
+ * @brief Encodes the api call path as a binary session opcode into opBuffer, e.g. "attack/42" as
+ * [API_OP_ATTACK][42] and "place/0,10,20,30,40" as [API_OP_PLACE][0][10][20][30][40].
+ */
+void encodeRequest(const char *path)
+{
+    static uint8_t *p;
+
+    p = opBuffer;
+    switch (path[0])
+    {
+    case 'a':
+        *p++ = API_OP_ATTACK;
+        break;
+    case 'p':
+        *p++ = API_OP_PLACE;
+        break;
+    case 'r':
+        *p++ = API_OP_READY;
+        break;
+    case 'l':
+        *p++ = API_OP_LEAVE;
+        break;
+    default:
+        *p++ = longPoll ? API_OP_WAIT : API_OP_STATE;
+        longPoll = false;
+        break;
+    }
+
+    // Positions follow the slash, separated by commas, each sent as a byte
+    path = strchr(path, '/');
+    if (path != NULL)
+    {
+        do
+        {
+            *p = 0;
+            while (*++path >= '0' && *path <= '9')
+                *p = *p * 10 + *path - '0';
+            p++;
+        } while (*path == ',' && p < opBuffer + sizeof(opBuffer));
+    }
+
+    request = opBuffer;
+    requestLen = (uint8_t)(p - opBuffer);
+}
+
+/// @brief Builds the request for path into url: a devicespec, or an http request line for the session channel
+void buildRequest(const char *path)
+{
+    static char *p;
+    static uint8_t kind;
+
+    versionProbe = false;
+    if (binaryMode)
+    {
+        encodeRequest(path);
+        return;
+    }
+
+    // Requests in a table name the session by token once the server has issued one
+    kind = 1 + usingChannel + (sessionToken[0] && query[0] ? 2 : 0);
+
+    // The start of the request only changes with the endpoint, channel or token, so it is kept in url between requests
+    if (kind != prefixKind)
+    {
+        p = appendText(url, usingChannel ? "GET " : "n:");
+        p = appendText(p, usingChannel ? channelPath : serverEndpoint);
+        if (kind > 2)
+        {
+            p = appendText(p, "s/");
+            p = appendText(p, sessionToken);
+        }
+
+        prefixLen = (uint8_t)(p - url);
+        prefixKind = kind;
+    }
+
+    p = url + prefixLen;
+    if (kind > 2)
+    {
+        // The token stands in for the table, player and api version, and state is the default call
+        if (strcmp(path, "state"))
+        {
+            *p++ = '/';
+            p = appendText(p, path);
+        }
+        p = appendText(p, "?seq=");
+    }
+    else
+    {
+        p = appendText(p, path);
+        p = appendText(p, query);
+        // Ask for v2 until the server shows it knows later versions. The tables list and a table's first call ask
+        // for API_CLIENT_VERSION to find out, unless that failed, in case the server does not take an unknown version.
+        versionProbe = !versionSeen && !versionFailed && (!query[0] || !versionAsked);
+        if (query[0] && versionProbe)
+            versionAsked = true;
+        p = appendText(p, query[0] ? "&bin=1&v=" : "?bin=1&v=");
+        p = appendText(p, versionSeen || versionProbe ? API_CLIENT_VERSION : "2");
+        if (query[0])
+            p = appendText(p, "&seq=");
+    }
+
+    // Send the last applied sequence so the server can reply with only what changed since
+    if (query[0])
+    {
+        itoa(stateSeq, p, 10);
+        p += strlen(p);
+
+        if (longPoll)
+        {
+            p = appendText(p, "&wait=" API_LONGPOLL_WAIT);
+            longPoll = false;
+        }
+    }
+
+    if (usingChannel)
+    {
+        p = appendText(p, " HTTP/1.1\r\nHost: ");
+        p = appendText(p, channelSpec + 8);
+        p = appendText(p, "\r\n\r\n");
+    }
+
+    *p = 0;
+    request = (uint8_t *)url;
+    requestLen = (uint8_t)(p - url);
+}
+
+/*
+ * @brief Picks how the next call goes out: over a binary session once the server offers one, else over the
+ * session channel, else as a plain http request. A socket that does not open is not tried again for the rest of the table.
+ */
+void selectSocket()
+{
+    static char *spec;
+
+    for (;;)
+    {
+        // Once the session has a token, calls can go over a binary session if the server offers one
+        binaryMode = query[0] && sessionToken[0] && (serverCaps & API_CAP_BINARY) && binarySpec[0] && !binaryFailed;
+        spec = binaryMode ? binarySpec : channelSpec;
+        if (socketSpec != spec)
+        {
+            closeChannel();
+            socketSpec = spec;
+        }
+
+        // Calls made while in a table reuse the session channel when there is one
+        usingChannel = query[0] && socketSpec[0];
+        if (!usingChannel || openChannel())
+            return;
+
+        if (binaryMode)
+            binaryFailed = true;
+        else
+            channelSpec[0] = 0;
+    }
+}
+
+/// @brief Starts a request for path, dropping any request still in flight
+void apiStart(const char *path)
+{
+    apiAbort();
+
+    selectSocket();
+    requestTimed = !longPoll;
+    requestSent = false;
+    commandInFlight = commandCount && path == commands[0];
+    pollInFlight = strcmp(path, "state") == 0;
+    statsInFlight = path == statsPath;
+    timeoutFrames = strcmp(path, "leave") ? API_TIMEOUT_FRAMES : API_LEAVE_TIMEOUT_FRAMES;
+    buildRequest(path);
+    apiStats.requests++;
+
+    switch (path[0])
+    {
+    case 't':
+        requestStats = &apiStats.endpoints[API_EP_TABLES];
+        break;
+    case 'a':
+        requestStats = &apiStats.endpoints[API_EP_ATTACK];
+        break;
+    case 'r':
+    case 'p':
+    case 'l':
+        requestStats = &apiStats.endpoints[API_EP_OTHER];
+        break;
+    default:
+        requestStats = statsInFlight ? &statsUploadStats : &apiStats.endpoints[API_EP_STATE];
+        break;
+    }
+    requestStats->requests++;
+    requestStart = getTime();
+
+    idleFrames = 0;
+    phase = PHASE_OPENING;
+}
+
+/// @brief Counts a completed call's round trip in the histogram of its endpoint
+void countRoundTrip(uint16_t jiffies)
+{
+    static uint8_t bucket;
+
+    for (bucket = 0; jiffies >= 2 && bucket < API_RTT_BUCKETS - 1; bucket++)
+        jiffies >>= 1;
+    requestStats->rtt[bucket]++;
+}
+
+/// @brief Appends a count, capped at STATS_COUNT_MAX, then sep
+char *appendCount(char *dest, uint16_t count, char sep)
+{
+    itoa(count < STATS_COUNT_MAX ? count : STATS_COUNT_MAX, dest, 10);
+    dest += strlen(dest);
+    *dest++ = sep;
+    return dest;
+}
+
+void queueStatsUpload()
+{
+    static char *p;
+    static uint8_t i;
+
+    // The last upload has not gone through yet, so these counts go with the one after
+    if (statsPath[0])
+        return;
+
+    p = appendText(statsPath, "stats/" STATS_PLATFORM "/");
+    for (i = 0; i < API_EP_COUNT; i++)
+    {
+        p = appendCount(p, apiStats.endpoints[i].requests, '.');
+        p = appendCount(p, apiStats.endpoints[i].failures, i < API_EP_COUNT - 1 ? '_' : '/');
+    }
+    for (i = 0; i < API_RTT_BUCKETS; i++)
+        p = appendCount(p, apiStats.endpoints[API_EP_ATTACK].rtt[i], '.');
+    p[-1] = 0;
+
+    memset(apiStats.endpoints, 0, sizeof(apiStats.endpoints));
+    state.apiCallWait = 0;
+}
+
+/*
+ * @brief Advances the request in flight by one step: idle -> opening -> awaiting -> reading -> done/error.
+ * Returns API_CALL_PENDING while in flight, then API_CALL_SUCCESS or API_CALL_ERROR once.
+ */
+uint8_t apiUpdate()
+{
+    static int8_t result;
+
+    result = 0;
+    switch (phase)
+    {
+    case PHASE_IDLE:
         return API_CALL_ERROR;
+
+    case PHASE_OPENING:
+        // Allow platform-specific override (e.g. for mocking network calls in emulator) via CUSTOM_FUJINET_CALLS
+        if (usingChannel)
+        {
+            if (!channelSend())
+                result = -1;
+        }
+        else
+        {
+            openStart = getTime();
+            if (network_open(url, OPEN_MODE_HTTP_GET, OPEN_TRANS_NONE))
+            {
+                result = -1;
+            }
+            else
+            {
+                apiStats.connects++;
+                apiStats.connectJiffies += getTime() - openStart;
+            }
+        }
+
+        requestSent = !result;
+        startResponse();
+        pendingLen = bodyLeft = 0;
+        phase = usingChannel ? PHASE_AWAITING : PHASE_READING;
+        break;
+
+    case PHASE_AWAITING:
+        result = awaitChannelResponse();
+        if (result > 0)
+        {
+            phase = PHASE_READING;
+            result = readResponse();
+        }
+        break;
+
+    case PHASE_READING:
+        result = readResponse();
+        break;
     }
 
-    return API_CALL_SUCCESS;
+    // Give up on a request that stopped making progress
+    if (!result && ++idleFrames > timeoutFrames)
+        result = -1;
+
+    if (!result)
+        return API_CALL_PENDING;
+
+    if (result > 0 && finishResponse())
+    {
+        if (requestTimed)
+            countRoundTrip(getTime() - requestStart);
+
+        // Keep the channel open for the next call
+        if (!usingChannel)
+            network_close(url);
+        phase = PHASE_IDLE;
+        return API_CALL_SUCCESS;
+    }
+
+    requestStats->failures++;
+
+    // On error, set first byte of clientState to 0, which is the number of tables or players,
+    // and request a full snapshot next time since clientState may no longer match the server
+    apiAbort();
+    if (usingChannel)
+        closeChannel();
+    clientState.firstByte = 0;
+    stateSeq = 0;
+    checksumValid = false;
+
+    // The server may have forgotten the session (e.g. it restarted), so rejoin by table and player,
+    // over http for the rest of this table
+    sessionToken[0] = 0;
+    if (binaryMode)
+        binaryFailed = true;
+
+    // The server may not take the version asked for, so fall back to v2
+    if (versionProbe)
+        versionFailed = true;
+    return API_CALL_ERROR;
 }
 
-void sendMove(char *move)
+/*
+ * @brief Makes an Api call, returning true if valid payload received. Blocks until done.
+ * Returns API_CALL_*:
+ *  1 - successfully received a payload
+ *  0 - error - aborted
+ */
+uint8_t apiCall(const char *path)
 {
-    if (move != NULL)
+    static uint8_t result;
+
+    // Show what is drawn so far, e.g. a status message, as this blocks
+    flushScreen();
+
+    // This replaces a background poll in flight, so poll again right after
+    if (apiBusy())
         state.apiCallWait = 0;
 
-    requestedMove = move;
+    apiStart(path);
+    chunkMax = sizeof(clientState);
+
+    while ((result = apiUpdate()) == API_CALL_PENDING)
+    {
+        if (idleFrames)
+            waitvsync();
+    }
+
+    return result;
+}
+
+/*
+ * @brief Queues a command to send to the server in the background, in place of the next state poll.
+ * Redundant commands are coalesced: a second "ready" cancels the first, a newer "place/.." or
+ * "attack/N" replaces a queued one, and "leave" replaces everything.
+ */
+void queueCommand(const char *command)
+{
+    static uint8_t i, first, len;
+    static char *slash;
+
+    // The command in flight may have reached the server, so it cannot be coalesced
+    first = commandInFlight && phase != PHASE_IDLE;
+
+    slash = strchr(command, '/');
+    len = slash ? (uint8_t)(slash - command) + 1 : (uint8_t)strlen(command) + 1;
+
+    if (strcmp(command, "leave") == 0)
+    {
+        // Leaving blocks on flushCommands(), so a command in flight gets no more tries
+        commandCount = first;
+        if (first)
+            commandTries = API_COMMAND_TRIES - 1;
+    }
+    else
+    {
+        for (i = first; i < commandCount; i++)
+        {
+            if (strncmp(commands[i], command, len) == 0)
+            {
+                // Toggled back, so neither needs to be sent
+                if (!slash)
+                {
+                    dropCommand(i);
+                    return;
+                }
+
+                strcpy(commands[i], command);
+                return;
+            }
+        }
+    }
+
+    // Full - drop the oldest command not in flight
+    if (commandCount == API_QUEUE_SIZE)
+        dropCommand(first);
+
+    strcpy(commands[commandCount++], command);
+    state.apiCallWait = 0;
+
+    // Send the command right away rather than wait on a state poll (possibly a long-poll)
+    if (pollInFlight)
+        apiAbort();
 }
 
+/// @brief Sends any queued commands, blocking until they are done. Used before leaving a table.
+void flushCommands()
+{
+    while (commandCount || apiBusy())
+    {
+        if (getStateFromServer() == STATE_UPDATE_PENDING && idleFrames)
+            waitvsync();
+    }
+}
+
+/*
+ * @brief Polls the server for the latest state, or sends a requested move, in the background.
+ * Call once per frame while apiBusy(). Returns STATE_UPDATE_PENDING until the response is in,
+ * then STATE_UPDATE_NOCHANGE if the response matched the state already in clientState.
+ */
 uint8_t getStateFromServer()
 {
+    static uint8_t result;
 
-    if (requestedMove)
+    if (phase == PHASE_IDLE)
     {
-        // Copy requested move to the temp buffer it is not already one and the same
-        if (requestedMove != tempBuffer)
-            strcpy(tempBuffer, requestedMove);
+        // The response to a command is the latest state, so it doubles as the poll.
+        // So does a stats upload, which a binary session has no opcode for, so it is dropped there.
+        if (!commandCount)
+            longPoll = !statsPath[0] && canLongPoll();
 
-        requestedMove = NULL;
+        subscribePush();
+        if (commandCount)
+            apiStart(commands[0]);
+        else if (statsPath[0] && !binaryMode)
+            apiStart(statsPath);
+        else
+        {
+            statsPath[0] = 0;
+            apiStart("state");
+        }
+        chunkMax = API_READ_CHUNK;
     }
-    else
+
+    result = apiUpdate();
+
+    // Done with the command once it went through, or after a few tries. Leave gets one, as the player is waiting on it.
+    if (commandInFlight && result != API_CALL_PENDING && commandCount &&
+        (result == API_CALL_SUCCESS || ++commandTries == API_COMMAND_TRIES || strcmp(commands[0], "leave") == 0))
+        dropCommand(0);
+
+    if (statsInFlight && result == API_CALL_SUCCESS)
+        statsPath[0] = 0;
+
+    switch (result)
     {
-        strcpy(tempBuffer, "state");
+    case API_CALL_PENDING:
+        return STATE_UPDATE_PENDING;
+    case API_CALL_SUCCESS:
+        if (!stateChanged)
+            return STATE_UPDATE_NOCHANGE;
+
+        changeTime = getTime();
+        return STATE_UPDATE_CHANGE;
     }
 
-    return apiCall(tempBuffer);
+    return STATE_UPDATE_ERROR;
+}
+
+/*
+ * @brief Returns frames to wait before the next poll, given the number of polls that failed in a row
+ * and what is going on in the game.
+ */
+uint16_t nextPollDelay(uint8_t failures)
+{
+    static uint8_t jps, i;
+    static uint16_t left, elapsed;
+
+    jps = getJiffiesPerSecond();
+
+    // Back off exponentially on errors, with jitter so clients do not all come back at once after a server restart
+    if (failures)
+    {
+        i = failures > 5 ? 4 : failures - 1;
+        return ((uint16_t)jps << i) + ((uint16_t)getRandomNumber(jps) << i);
+    }
+
+    // Commands waiting to go out
+    if (commandCount)
+        return 0;
+
+    // Changes are pushed, or the server holds the call until something changes
+    if (pushOpen)
+        return API_PUSH_POLL_FRAMES;
+    if (canLongPoll())
+        return 0;
+
+    // The server knows when the next change is due, e.g. a bot move or a countdown
+    if (pollHint)
+        return pollHint;
+
+    if (clientState.game.status == STATUS_LOBBY)
+    {
+        // Slow until someone is ready and the countdown may start
+        for (i = 0; i < clientState.lobby.playerCount; i++)
+        {
+            if (clientState.lobby.players[i].ready)
+                return jps / 2;
+        }
+        return jps * 3;
+    }
+
+    // Spectators can afford to lag behind
+    if (clientState.game.playerStatus == PLAYER_STATUS_VIEWING)
+        return jps * 2;
+
+    if (clientState.game.status < STATUS_GAMESTART || clientState.game.status == STATUS_GAMEOVER)
+        return jps * 2;
+
+    // Poll fast around the turn hand-off, when the move time runs out
+    left = clientState.game.moveTime * jps;
+    elapsed = getTime() - changeTime;
+    left = elapsed < left ? left - elapsed : 0;
+    if (left < jps * 2)
+        return jps / 4;
+
+    // Nothing changes on this player's turn until they move (which polls right away) or the time runs out
+    if (clientState.game.activePlayer == 0)
+        return left - jps * 2;
+
+    return jps;
 }
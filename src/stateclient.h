@@ -15,10 +15,116 @@
 #define STATE_UPDATE_ERROR (0)
 #define STATE_UPDATE_CHANGE (1)
 #define STATE_UPDATE_NOCHANGE (2)
+#define STATE_UPDATE_PENDING (3)
+
+// Response header sent by v5 servers: [type][capabilities][seq lo][seq hi][poll hint lo][poll hint hi]
+// The poll hint is jiffies until the server expects the next change, or 0 if it does not know.
+// A v2 server sends the raw layout instead, which never starts with a byte >= API_RESP_FULL
+#define API_HEADER_SIZE 6
+#define API_RESP_FULL 0xF0  // Full snapshot of the layout follows
+#define API_RESP_PATCH 0xF1 // Patch records follow: [offset lo][offset hi][len][len bytes]
+
+// Server capability bits, sent in the second header byte
+#define API_CAP_LONGPOLL 0x01 // Holds "state" calls with &wait=N until seq changes or N seconds pass
+#define API_CAP_PUSH 0x02     // Sends a datagram to subscribed clients on API_PUSH_PORT when a table changes
+#define API_CAP_TOKEN 0x04    // A session token of API_TOKEN_SIZE characters follows the header
+#define API_CAP_BINARY 0x08   // Accepts binary sessions on API_BINARY_PORT
+
+// Once a token is issued, calls go to s/<token>[/path]?seq=N instead of path?table=..&player=..&bin=1&v=N&seq=N
+#define API_TOKEN_SIZE 4
+
+// Binary session: the client opens a tcp socket to API_BINARY_PORT and sends
+// [API_OP_HELLO][token][seq lo][seq hi]. Each request is then an opcode, and each response
+// is framed as [len lo][len hi] followed by the usual header and payload.
+#define API_BINARY_PORT "6503"
+#define API_OP_STATE 0x01
+#define API_OP_WAIT 0x02   // State, held until the table changes (long-poll)
+#define API_OP_READY 0x03
+#define API_OP_LEAVE 0x04
+#define API_OP_ATTACK 0x05 // [pos]
+#define API_OP_PLACE 0x06  // [pos] x 5
+#define API_OP_HELLO 0x07  // [token][seq lo][seq hi]
+
+// Push notification: [API_PUSH_CHANGED][seq lo][seq hi]. Clients subscribe by sending their query string.
+#define API_PUSH_PORT "6502"
+#define API_PUSH_CHANGED 0xF2
+#define API_PUSH_SIZE 3
+
+// Frames between checks of the push channel
+#define API_PUSH_CHECK_FRAMES 8
+
+// Frames between safety polls while push notifications are active
+#define API_PUSH_POLL_FRAMES 600
+
+// Seconds the server may hold a long-poll request
+#define API_LONGPOLL_WAIT "10"
+
+// Frames a request may go without receiving data, longer than a long-poll
+#define API_TIMEOUT_FRAMES 900
+
+// Frames a "leave" may go without receiving data. It is sent once, while the player waits.
+#define API_LEAVE_TIMEOUT_FRAMES 120
+
+// Most response bytes read per frame by a background request, so input and animation keep running
+#define API_READ_CHUNK 128
+
+// Patches never exceed the patch buffer (tempBuffer); the server sends a full snapshot instead
+#define API_PATCH_RECORD_SIZE 3
+
+// Outbound command queue: commands waiting to be sent, longest command (e.g. "place/.." with 5 positions),
+// and attempts before a failing command is dropped
+#define API_QUEUE_SIZE 4
+#define API_COMMAND_SIZE 28
+#define API_COMMAND_TRIES 3
+
+// Endpoints counted apart in ApiStats. Ready, place and leave count as other, and stats uploads are not counted.
+#define API_EP_STATE 0
+#define API_EP_TABLES 1
+#define API_EP_ATTACK 2
+#define API_EP_OTHER 3
+#define API_EP_COUNT 4
+
+// Round trip histogram, in jiffies from the start of a call to its last byte: under 2, 2-3, 4-7 .. 64-127, then 128 and up.
+// Long-polls are left out, since the server holds them on purpose.
+#define API_RTT_BUCKETS 8
+
+typedef struct
+{
+    uint16_t requests;
+    uint16_t failures;
+    uint32_t bytes;                 // Response body bytes read
+    uint16_t rtt[API_RTT_BUCKETS];
+} ApiEndpointStats;
+
+typedef struct
+{
+    uint16_t requests;
+    uint16_t connects;       // Devicespecs or session channels opened
+    uint16_t connectJiffies; // Total time spent opening them
+    ApiEndpointStats endpoints[API_EP_COUNT];
+} ApiStats;
+
+extern ApiStats apiStats;
+
+/// @brief Uploads the request counts and attack round trips to the server's stats endpoint with the next poll, then starts counting afresh.
+/// The upload is retried with later polls until it goes through.
+void queueStatsUpload();
 
 void updateState(bool isTables);
 uint8_t getStateFromServer();
 uint8_t apiCall(const char *path );
-void sendMove(char* move);
+void queueCommand(const char *command);
+void flushCommands();
+void resetApiSession();
+bool apiChannelAvailable();
+bool canLongPoll();
+void apiStart(const char *path);
+uint8_t apiUpdate();
+void apiAbort();
+bool apiBusy();
+bool apiReceivingState();
+bool apiStateComplete();
+bool checkPush();
+uint16_t nextPollDelay(uint8_t failures);
 
 #endif /* STATECLIENT_H */
@@ -0,0 +1,122 @@
+/*******************************************************************
+ *
+ * Do NOT include standard library headers (e.g. conio, std*).
+ * Instead, add to standard_lib.h, which gets included in misc.h
+ *
+ ******************************************************************/
+
+#include "misc.h"
+#include "stateclient.h"
+#include "gamelogic.h"
+#include "timeline.h"
+#include "task.h"
+
+static uint16_t pollLine;
+static uint8_t failedApiCalls, blinkFrames;
+static bool changePending;
+
+void runTasks()
+{
+    waitvsync();
+    pollTask();
+    renderTask();
+    processInput();
+}
+
+void resetTasks()
+{
+    pollLine = 0;
+    failedApiCalls = 0;
+    changePending = false;
+    timelineClear();
+    redrawCancel();
+    resetInputTasks();
+}
+
+uint8_t pollTask()
+{
+    static uint8_t result;
+
+    TASK_BEGIN(pollLine);
+
+    for (;;)
+    {
+        // Poll right away when the server pushes word of a change
+        if (!apiBusy() && checkPush())
+            state.apiCallWait = 0;
+
+        // Poll the server every so often. The poll runs in the background, a step each frame, until the response is in.
+        if (apiBusy() || !state.apiCallWait--)
+        {
+            // Housekeeping - allows platform specific housekeeping, like stopping Attract/screensaver mode in Atari
+            if (!apiBusy())
+                housekeeping();
+
+            result = getStateFromServer();
+            if (result == STATE_UPDATE_ERROR)
+            {
+                // ERROR - Back off to avoid hammering the server if getting bad responses
+                if (failedApiCalls < 5)
+                {
+                    failedApiCalls++;
+                }
+                state.apiCallWait = nextPollDelay(failedApiCalls);
+
+                // After consequitive failures, let the player know we are experiencing technical difficulties
+                if (failedApiCalls > 1)
+                {
+                    drawConnectionIcon(true);
+                    TASK_PAUSE(pollLine, blinkFrames, 30);
+                    drawConnectionIcon(false);
+                    TASK_PAUSE(pollLine, blinkFrames, 30);
+                    drawConnectionIcon(true);
+                }
+            }
+            else if (result != STATE_UPDATE_PENDING)
+            {
+                // Clear connection failure message
+                if (failedApiCalls > 1)
+                {
+                    drawConnectionIcon(false);
+                }
+                failedApiCalls = 0;
+
+                // Nothing to draw if the state is the same, unless the screen needs a redraw
+                if (result == STATE_UPDATE_CHANGE || state.drawBoard)
+                    changePending = true;
+
+                // Poll again when the game calls for it
+                state.apiCallWait = nextPollDelay(0);
+            }
+        }
+
+        TASK_YIELD(pollLine);
+    }
+
+    TASK_END(pollLine);
+}
+
+bool renderTask()
+{
+    // Animations and redraws read clientState, which may be part way through a response
+    if (!apiStateComplete())
+        return false;
+
+    timelineTick();
+    redrawTick();
+
+    // The result of a game stays up until the player closes it, while the polls carry on underneath
+    if (!changePending || state.waitingOnEndGameContinue)
+        return false;
+
+    changePending = false;
+    processStateChange();
+    return true;
+}
+
+#ifdef __HOST__
+bool renderPending()
+{
+    return changePending;
+}
+#endif
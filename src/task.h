@@ -0,0 +1,86 @@
+/*******************************************************************
+ *
+ * Do NOT include standard library headers (e.g. conio, std*).
+ * Instead, add to standard_lib.h, which gets included in misc.h
+ *
+ ******************************************************************/
+
+#ifndef TASK_H
+#define TASK_H
+
+// Stackless tasks (protothreads), so polling, drawing and input share the frame instead of taking turns.
+// A task is a function runTasks() calls once a frame. It keeps its place in a uint16_t (0 to start over)
+// and its locals in statics, and returns TASK_RUNNING when it yields the rest of the frame, or TASK_DONE.
+// The TASK_ macros that wait must sit outside any switch in the task body, and only one per source line.
+// Each task does a bounded step per frame:
+//   poll   - checkPush(), then a step of the background call (at most API_READ_CHUNK bytes), or a new poll when due
+//   render - a step of the animation timeline, a gamefield of a full board redraw, and the latest state once nothing holds it back
+//   input  - one read of the keyboard/joystick, then a step of the flow it drives (lobby, ship placement, aiming)
+// Sounds are still played where they happen, and the board's sounds are scheduled on the timeline.
+
+#define TASK_DONE 0
+#define TASK_RUNNING 1
+
+#define TASK_BEGIN(line) \
+    switch (line)        \
+    {                    \
+    case 0:
+
+#define TASK_END(line) \
+    }                  \
+    line = 0;          \
+    return TASK_DONE;
+
+/// Ends the task early, from anywhere in its body
+#define TASK_EXIT(line)   \
+    do                    \
+    {                     \
+        line = 0;         \
+        return TASK_DONE; \
+    } while (0)
+
+/// Picks up here next frame
+#define TASK_YIELD(line)      \
+    do                        \
+    {                         \
+        line = __LINE__;      \
+        return TASK_RUNNING;  \
+    case __LINE__:;           \
+    } while (0)
+
+/// Yields each frame until cond holds (checked right away first)
+#define TASK_WAIT_UNTIL(line, cond) \
+    do                              \
+    {                               \
+        line = __LINE__;            \
+    case __LINE__:                  \
+        if (!(cond))                \
+            return TASK_RUNNING;    \
+    } while (0)
+
+/// Yields for frames frames, counting down a uint8_t static
+#define TASK_PAUSE(line, counter, frames)  \
+    do                                     \
+    {                                      \
+        counter = frames;                  \
+        TASK_WAIT_UNTIL(line, !counter--); \
+    } while (0)
+
+/// @brief Runs a frame: waits for vsync, then gives the poll, render and input tasks their turn
+void runTasks();
+
+/// @brief Starts every task over, with nothing left to draw, for a new table
+void resetTasks();
+
+/// @brief Polls the server when due and steps the call in flight. Never finishes.
+uint8_t pollTask();
+
+/// @brief Steps the animation timeline and any full board redraw, and draws the latest state unless the game result is still up. Returns true if a state was drawn.
+bool renderTask();
+
+#ifdef __HOST__
+/// @brief Returns true while a state is waiting to be drawn (host builds only)
+bool renderPending();
+#endif
+
+#endif /*TASK_H*/
@@ -0,0 +1,215 @@
+/*******************************************************************
+ *
+ * Do NOT include standard library headers (e.g. conio, std*).
+ * Instead, add to standard_lib.h, which gets included in misc.h
+ *
+ ******************************************************************/
+
+#include "misc.h"
+#include "timeline.h"
+
+#define TRACK_FREE 0
+#define TRACK_CELL 1
+#define TRACK_BLINK 2 // A cell, drawn as value & 1
+#define TRACK_LEGEND 3
+#define TRACK_NAME 4
+#define TRACK_SOUND 5
+
+typedef struct
+{
+    uint8_t kind;
+    uint8_t target;   // Quadrant or player
+    uint8_t index;    // Cell, ship or sound
+    uint8_t value;    // Next cell frame, or the legend/name status to end on
+    int8_t step;      // Added to a cell frame after each draw
+    uint8_t count;    // Draws left after the next one
+    uint8_t interval; // Frames between draws
+    uint8_t wait;     // Frames until the next draw
+} Track;
+
+static Track tracks[TIMELINE_TRACKS];
+static uint8_t busy;
+
+/// @brief Draws the track's next frame, then frees it if that was the last
+static void drawTrack(Track *track)
+{
+    switch (track->kind)
+    {
+    case TRACK_CELL:
+    case TRACK_BLINK:
+        drawGamefieldUpdate(track->target, clientState.game.players[track->target].gamefield, track->index,
+                            track->kind == TRACK_BLINK ? track->value & 1 : track->value);
+        track->value += track->step;
+        break;
+
+    case TRACK_LEGEND:
+        // Alternates, counting back from the end so the last draw is the status
+        drawLegendShip(track->target, track->index, shipSize[track->index], track->value ^ (track->count & 1));
+        break;
+
+    case TRACK_NAME:
+        drawPlayerName(track->target, clientState.game.players[track->target].name, track->value ^ (track->count & 1));
+        break;
+
+    case TRACK_SOUND:
+        switch (track->index)
+        {
+        case TIMELINE_SOUND_HIT:
+            soundHit();
+            break;
+        case TIMELINE_SOUND_MISS:
+            soundMiss();
+            break;
+        default:
+            soundSink();
+            break;
+        }
+        break;
+    }
+
+    if (track->count)
+    {
+        track->count--;
+        track->wait = track->interval;
+    }
+    else
+    {
+        track->kind = TRACK_FREE;
+        busy--;
+    }
+}
+
+/// @brief Moves a track to its last frame
+static void skipTrack(Track *track)
+{
+    track->value += track->step * track->count;
+    track->count = 0;
+    drawTrack(track);
+}
+
+/// @brief Starts a track, drawing its first frame now if there is no delay
+static void addTrack(uint8_t kind, uint8_t target, uint8_t index, uint8_t value, int8_t step, uint8_t count, uint8_t interval, uint8_t delay)
+{
+    static uint8_t i;
+    static Track *track;
+    static Track overflow;
+
+    for (i = 0; i < TIMELINE_TRACKS; i++)
+    {
+        if (tracks[i].kind == TRACK_FREE)
+            break;
+    }
+    track = i < TIMELINE_TRACKS ? &tracks[i] : &overflow;
+
+    track->kind = kind;
+    track->target = target;
+    track->index = index;
+    track->value = value;
+    track->step = step;
+    track->count = count;
+    track->interval = interval;
+    track->wait = delay;
+    busy++;
+
+    // Full - a sound plays now and anything else shows where it would end
+    if (track == &overflow)
+        skipTrack(track);
+    else if (!delay)
+        drawTrack(track);
+}
+
+void timelineCell(uint8_t quadrant, uint8_t pos, uint8_t first, int8_t step, uint8_t count, bool blink, uint8_t interval, uint8_t delay)
+{
+    addTrack(blink ? TRACK_BLINK : TRACK_CELL, quadrant, pos, first, step, count, interval, delay);
+}
+
+void timelineLegend(uint8_t player, uint8_t index, uint8_t count, uint8_t status, uint8_t interval, uint8_t delay)
+{
+    addTrack(TRACK_LEGEND, player, index, status, 0, count, interval, delay);
+}
+
+void timelinePlayerName(uint8_t player, uint8_t count, bool active, uint8_t interval, uint8_t delay)
+{
+    addTrack(TRACK_NAME, player, 0, active, 0, count, interval, delay);
+}
+
+void timelineSound(uint8_t sound, uint8_t delay)
+{
+    addTrack(TRACK_SOUND, 0, sound, 0, 0, 0, 0, delay);
+}
+
+void timelineTick()
+{
+    static uint8_t i, left;
+
+    // Stops at the last track in use
+    for (i = 0, left = busy; left; i++)
+    {
+        if (tracks[i].kind != TRACK_FREE)
+        {
+            left--;
+            if (!--tracks[i].wait)
+                drawTrack(&tracks[i]);
+        }
+    }
+}
+
+bool timelineBusy()
+{
+    return busy != 0;
+}
+
+void timelineFinish()
+{
+    static uint8_t i, next;
+    static uint16_t end, nextEnd;
+
+    // The track that would end first goes first, so a cell with two tracks ends on the later one
+    while (busy)
+    {
+        nextEnd = 0xFFFF;
+        for (i = 0; i < TIMELINE_TRACKS; i++)
+        {
+            if (tracks[i].kind == TRACK_FREE)
+                continue;
+
+            end = tracks[i].wait + tracks[i].interval * tracks[i].count;
+            if (end < nextEnd)
+            {
+                nextEnd = end;
+                next = i;
+            }
+        }
+
+        if (tracks[next].kind == TRACK_SOUND)
+        {
+            tracks[next].kind = TRACK_FREE;
+            busy--;
+        }
+        else
+        {
+            skipTrack(&tracks[next]);
+        }
+    }
+}
+
+#ifdef __HOST__
+// Only the host benchmarks wait on the timeline, and the 8-bit linkers keep every function they are given
+void timelineWait()
+{
+    while (busy)
+    {
+        waitvsync();
+        timelineTick();
+    }
+}
+#endif
+
+void timelineClear()
+{
+    static uint8_t i;
+
+    for (i = 0; i < TIMELINE_TRACKS; i++)
+        tracks[i].kind = TRACK_FREE;
+    busy = 0;
+}
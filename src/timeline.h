@@ -0,0 +1,51 @@
+/*******************************************************************
+ *
+ * Do NOT include standard library headers (e.g. conio, std*).
+ * Instead, add to standard_lib.h, which gets included in misc.h
+ *
+ ******************************************************************/
+
+#ifndef TIMELINE_H
+#define TIMELINE_H
+
+// Animation timeline - the board's animations as tracks that advance a step every few frames,
+// so a state change returns right away and its animations play alongside input and polling.
+// Each track draws its first frame after delay frames (right away if 0), then count more, interval frames apart.
+
+// Tracks at once. One attack on a 4 player table needs at most 12, a track that does not fit jumps to its last frame.
+#define TIMELINE_TRACKS 12
+
+#define TIMELINE_SOUND_HIT 0
+#define TIMELINE_SOUND_MISS 1
+#define TIMELINE_SOUND_SINK 2
+
+/// @brief Animates a gamefield cell through drawGamefieldUpdate() frames first, first+step, .. If blink is set, frames alternate between the cell (even) and its attack marker (odd).
+void timelineCell(uint8_t quadrant, uint8_t pos, uint8_t first, int8_t step, uint8_t count, bool blink, uint8_t interval, uint8_t delay);
+
+/// @brief Blinks a ship on a player's legend, ending on status (0 sunk, 1 intact)
+void timelineLegend(uint8_t player, uint8_t index, uint8_t count, uint8_t status, uint8_t interval, uint8_t delay);
+
+/// @brief Blinks a player's name, ending on active
+void timelinePlayerName(uint8_t player, uint8_t count, bool active, uint8_t interval, uint8_t delay);
+
+/// @brief Plays a TIMELINE_SOUND_ after delay frames
+void timelineSound(uint8_t sound, uint8_t delay);
+
+/// @brief Advances every track a frame. Call once per vsync while the board is up.
+void timelineTick();
+
+/// @brief Returns true while any track is still to play
+bool timelineBusy();
+
+/// @brief Draws every track's last frame right away, in the order they would have ended. Pending sounds are dropped.
+void timelineFinish();
+
+#ifdef __HOST__
+/// @brief Plays the rest of the timeline out (host builds only)
+void timelineWait();
+#endif
+
+/// @brief Drops every track without drawing, when the screen they draw on is going away
+void timelineClear();
+
+#endif /*TIMELINE_H*/
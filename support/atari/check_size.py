@@ -0,0 +1,56 @@
+"""
+Checks the Atari build stays below the address the stack grows down to.
+
+With BASIC enabled, the cc65 stack starts at $9C1F, so program and variables must end below
+$9A1F to leave it 512 bytes (see src/atari/graphics.c). Reads the segment list of the ld65
+map file, prints where the highest segment ends and the bytes left, and fails if none are.
+
+Run by the atari/executable-post step of the Makefile:
+  python3 support/atari/check_size.py build/atari/fbs.map [9A1F]
+"""
+
+import re
+import sys
+
+SEGMENT = re.compile(r"^(\w+)\s+([0-9A-F]{6})\s+([0-9A-F]{6})\s+([0-9A-F]{6})\s+[0-9A-F]+\s*$")
+
+
+def segments(path):
+    """Yields (name, start, end, size) for each segment in the map's segment list"""
+    listed = False
+    with open(path) as f:
+        for line in f:
+            if line.startswith("Segment list:"):
+                listed = True
+            elif listed and line.startswith("Exports list"):
+                return
+            elif listed:
+                m = SEGMENT.match(line)
+                if m:
+                    yield m.group(1), int(m.group(2), 16), int(m.group(3), 16), int(m.group(4), 16)
+
+
+def main():
+    if len(sys.argv) < 2:
+        print(__doc__.strip())
+        return 2
+
+    limit = int(sys.argv[2], 16) if len(sys.argv) > 2 else 0x9A1F
+
+    # Zero page and the file headers and run vector of the xex sit low, out of the stack's way
+    used = [s for s in segments(sys.argv[1]) if s[1] >= 0x100 and s[3]]
+    if not used:
+        print("check_size: no segments in %s" % sys.argv[1])
+        return 1
+
+    name, _, end, _ = max(used, key=lambda s: s[2])
+    if end >= limit:
+        print("check_size: %s ends at $%04X, %d bytes past $%04X" % (name, end, end - limit + 1, limit))
+        return 1
+
+    print("check_size: %s ends at $%04X, %d bytes below $%04X" % (name, end, limit - end - 1, limit))
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
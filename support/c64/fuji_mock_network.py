@@ -1,96 +1,480 @@
-import time
-import os
-import requests  # pip install requests
+"""
+Mock FujiNet network bridge for testing the C64 build in VICE.
 
+Point drive 11 at the working directory (--path), then run: make c64 VICE=1
+The app saves/reads appkeys in that folder and calls this bridge for network access:
 
-# To test in Vice, point drive 11 to the following directory:
-# Then run: make c64 VICE=1
-# The app will then save/read appkeys from this folder and call this bridge for network access
-workingPath = "/Users/eric/Documents/projects/vice-device"
+  1. The C64 writes the devicespec (e.g. n:https://host/state?...) to vice-out
+  2. The bridge fetches it, writes the body to vice-in (via a temp file, so it appears whole)
+  3. The bridge deletes vice-out, which tells the C64 the response is ready
 
+One bridge serves any number of VICE instances, each with drive 11 on its own folder (and so
+its own appkeys). Give --path once per folder, or --instances N to use PATH/player1..N.
+Calls from different instances are fetched in parallel, and each folder gets a bridge.log
+of its calls.
 
-def download_url_as_bytes(url):
-    """
-    Download the content from a given URL and return it as a byte array.
-    """
-    try:
-        response = requests.get(url, headers = {"User-Agent": "MockFujiNetBridge/1.0","Accept": "application/json"})
-        response.raise_for_status()  # Raise an exception for bad status codes (4xx or 5xx)
-        return response.content
-    except requests.exceptions.RequestException as e:
-        print(f"Error downloading URL: {e}")
-        return bytes()
-        
-def processWatchFile():
-    """
-    Read the command of the watch file and send it as a message via the meshtastic interface.
-    """
-
-    with open(watchFile, "r", encoding="utf-8") as file:
-        command = file.read().strip().lower()
-        if command.startswith("n:"):
-            command = command[2:]  # remove first two characters ("n:")
-        print(f"Sending: {command}")
-
-        if os.path.exists(outFile):
-            os.remove(outFile)
-
-        payload = download_url_as_bytes(command) 
-        print(f"Received {len(payload)} bytes:")
-        #time.sleep(0.200)  #  simulate delay
-        hexdump(payload)
-
-        with open(outFile, "wb") as file:
-            file.write(payload)
+On Linux, vice-out is picked up through inotify as soon as VICE closes it. Elsewhere the
+folders are polled every 10ms. Each instance keeps its own kept-alive http connection, so
+only its first call to a host pays for connecting (and the TLS handshake).
+
+Usage:
+  python3 support/c64/fuji_mock_network.py [--path DIR ...] [--instances N] [--local http://127.0.0.1:8080/]
+                                           [--conditions NAME] [--profiles FILE] [--seed N]
+                                           [--capture FILE] [--stats SECONDS] [--quiet]
+
+--local sends every call to a local server (e.g. support/server/fbs_server.py) instead of the
+host in the devicespec, without touching the appkey.
+
+--conditions NAME simulates a bad network between the C64 and the server, using a profile or
+scenario from --profiles (support/c64/netprofiles.json by default). A profile may set:
+
+  latency    round trip delay in ms: fixed:MS, uniform:LO:HI, normal:MEAN:SD or lognormal:MEDIAN:SIGMA
+  bandwidth  bytes per second for the request and response, e.g. 1920 for 19200 baud SIO
+  spike      [chance, ms] of an extra stall on top of the latency
+  truncate   chance the response is cut short
+  error      chance the response comes back empty, like a failed http call
+  drop       chance the call is never answered, so the client times out
+  base       another profile to start from
+
+A scenario steps through profiles over time: {"loop": true, "steps": [{"profile": NAME, "seconds": N}, ...]}.
+A step without seconds lasts for the rest of the run. --seed makes the conditions repeatable.
+
+--capture FILE records each instance's calls and responses, with their times, to FILE in its
+folder (tests/replay/capture.h has the format). make replay CAPTURE=FILE plays one back through
+the client on the host, at full speed or in real time.
+"""
+
+import argparse
+import asyncio
+import ctypes
+import ctypes.util
+import http.client
+import json
+import math
+import os
+import random
+import struct
+import time
+from urllib.parse import urlsplit, urlunsplit
+
+WATCH_FILE = "vice-out"
+OUT_FILE = "vice-in"
+LOG_FILE = "bridge.log"
+POLL_SECONDS = 0.010
+PROFILES_FILE = os.path.join(os.path.dirname(os.path.abspath(__file__)), "netprofiles.json")
+
+IN_CLOSE_WRITE = 0x00000008
+IN_MOVED_TO = 0x00000080
+IN_NONBLOCK = 0x00000800
+INOTIFY_EVENT = struct.Struct("iIII")
+
+CAPTURE_MAGIC = b"FBC1"
+CAPTURE_RECORD = struct.Struct("<IHH")  # ms, url length, body length
+CAPTURE_NO_RESPONSE = 0xFFFF
 
-        if os.path.exists(watchFile):
-            os.remove(watchFile)
 
 def hexdump(data: bytes, width: int = 16):
     for i in range(0, len(data), width):
-        chunk = data[i:i+width]
-        
-        # Hex view
-        hex_bytes = " ".join(f"{b:02x}" for b in chunk)
-        
-        # Pad hex output to align text view
-        hex_bytes = hex_bytes.ljust(width * 3)
-        
+        chunk = data[i:i + width]
+
+        # Hex view, padded to align the text view
+        hex_bytes = " ".join(f"{b:02x}" for b in chunk).ljust(width * 3)
+
         # Text view (printable ASCII, else '.')
         text = "".join(chr(b) if 32 <= b < 127 else "." for b in chunk)
-        
+
         print(f"{i:08x}  {hex_bytes}  {text}")
 
-print("Mock FujiNet Network Bridge")
-print("-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-")
 
-watchFile = workingPath + "/vice-out"
-outFile = workingPath + "/vice-in"
+def sample_latency(spec, rng):
+    """Draws one delay in ms from a latency spec such as lognormal:60:0.5"""
+    kind, *args = spec.split(":")
+    args = [float(a) for a in args]
+    if kind == "fixed":
+        return args[0]
+    if kind == "uniform":
+        return rng.uniform(args[0], args[1])
+    if kind == "normal":
+        return max(0.0, rng.gauss(args[0], args[1]))
+    if kind == "lognormal":
+        return args[0] * math.exp(rng.gauss(0.0, args[1]))
+    raise ValueError(f"unknown latency distribution: {spec}")
+
+
+class Conditions:
+    """Network conditions over time: one profile, or a scenario stepping through several"""
+
+    def __init__(self, file, name):
+        with open(file, encoding="utf-8") as f:
+            config = json.load(f)
+        self.profiles = config.get("profiles", {})
+        scenarios = config.get("scenarios", {})
+
+        if name in scenarios:
+            self.steps = [(self.profile(step["profile"]), step.get("seconds")) for step in scenarios[name]["steps"]]
+            self.loop = scenarios[name].get("loop", False)
+        else:
+            self.steps = [(self.profile(name), None)]
+            self.loop = False
+        self.start = time.monotonic()
+
+    def profile(self, name):
+        if name not in self.profiles:
+            raise SystemExit(f"unknown profile or scenario: {name}")
+        profile = dict(self.profiles[name])
+        base = profile.pop("base", None)
+        if base:
+            profile = {**self.profile(base), **profile}
+        profile["name"] = name
+        if "latency" in profile:
+            sample_latency(profile["latency"], random.Random())  # Reject a bad spec up front
+        return profile
+
+    def current(self):
+        """The profile in effect now"""
+        elapsed = time.monotonic() - self.start
+        total = sum(seconds or 0 for _, seconds in self.steps)
+        if self.loop and total and all(seconds for _, seconds in self.steps):
+            elapsed %= total
+        for profile, seconds in self.steps:
+            if seconds is None or elapsed < seconds:
+                return profile
+            elapsed -= seconds
+        return self.steps[-1][0]
+
+
+class Instance:
+    """One VICE instance: its drive 11 folder, http connection, call log and latency stats"""
+
+    def __init__(self, path, local, quiet, conditions=None, seed=None, capture=None):
+        self.path = path
+        self.name = os.path.basename(path) or path
+        self.local = local
+        self.quiet = quiet
+        self.conditions = conditions
+        self.rng = random.Random(seed)
+        self.ignore = None  # The dropped call's vice-out (mtime, size), left for the client to time out
+        self.conn = None
+        self.conn_key = None
+        self.busy = False
+        self.again = False  # vice-out changed while a call was in progress, so look at it again when it ends
+        self.watch_file = os.path.join(path, WATCH_FILE)
+        self.out_file = os.path.join(path, OUT_FILE)
+        self.log = open(os.path.join(path, LOG_FILE), "a", encoding="utf-8")
+        self.latencies = []
+        self.errors = 0
+        self.bytes = 0
+        self.injected = {"drop": 0, "error": 0, "truncate": 0}
+        self.capture = None
+        if capture:
+            self.capture = open(os.path.join(path, capture), "wb")
+            self.capture.write(CAPTURE_MAGIC)
+            self.capture_start = time.monotonic()
+
+    def route(self, url):
+        """Sends the call to the local server, keeping the path and query"""
+        if not self.local:
+            return url
+        parts = urlsplit(url)
+        path = self.local.path.rstrip("/") + parts.path
+        return urlunsplit((self.local.scheme, self.local.netloc, path, parts.query, ""))
+
+    def connection(self, parts):
+        """The kept-alive connection to the url's host, opening a new one if the host changed"""
+        key = (parts.scheme, parts.netloc)
+        if self.conn is None or self.conn_key != key:
+            if self.conn:
+                self.conn.close()
+            cls = http.client.HTTPSConnection if parts.scheme == "https" else http.client.HTTPConnection
+            self.conn = cls(parts.netloc, timeout=30)
+            self.conn_key = key
+        return self.conn
+
+    def fetch(self, url):
+        """Blocking GET, run on a worker thread. Returns the body, or None if the call failed."""
+        parts = urlsplit(url)
+        path = (parts.path or "/") + (f"?{parts.query}" if parts.query else "")
+
+        # A kept-alive connection the server since closed fails on first use, so try a fresh one once
+        for attempt in range(2):
+            conn = self.connection(parts)
+            try:
+                conn.request("GET", path, headers={"User-Agent": "MockFujiNetBridge/1.0"})
+                response = conn.getresponse()
+                content = response.read()
+                if response.status != 200:
+                    print(f"[{self.name}] Error downloading URL: http {response.status}")
+                    return None
+                return content
+            except (OSError, http.client.HTTPException) as e:
+                conn.close()
+                self.conn = None
+                if attempt:
+                    print(f"[{self.name}] Error downloading URL: {e}")
+        return None
+
+    def superseded(self, stat, request):
+        """True if vice-out no longer holds the call being answered: the client gave up on it and wrote another"""
+        try:
+            now = os.stat(self.watch_file)
+            with open(self.watch_file, "r", encoding="utf-8") as file:
+                return (now.st_mtime_ns, now.st_size) != (stat.st_mtime_ns, stat.st_size) or file.read() != request
+        except OSError:
+            return True
+
+    async def process(self):
+        """Answers the call in vice-out, if there is one. A change while a call is in progress is answered after it."""
+        if self.busy:
+            self.again = True
+            return
+
+        self.busy = True
+        try:
+            self.again = True
+            while self.again:
+                self.again = False
+                await self.answer()
+        finally:
+            self.busy = False
+
+    async def answer(self):
+        """Answers the call in vice-out, if there is one"""
+        try:
+            stat = os.stat(self.watch_file)
+            if (stat.st_mtime_ns, stat.st_size) == self.ignore:
+                return
+            with open(self.watch_file, "r", encoding="utf-8") as file:
+                request = file.read()
+        except OSError:
+            return
+        command = request.strip()
+        if not command:
+            return
+
+        start = time.perf_counter()
+        devicespec = command
+        if command.lower().startswith("n:"):
+            command = command[2:]
+        url = self.route(command)
+        profile = self.conditions.current() if self.conditions else {}
+        delay = self.delay(profile, len(command))
+
+        # Half the delay on the way to the server, the rest (and the response's transfer time) on the way back
+        await asyncio.sleep(delay / 2000)
+        payload = await asyncio.to_thread(self.fetch, url)
+        if payload is None:
+            self.errors += 1
+            payload = bytes()
+
+        outcome = self.outcome(profile)
+        if outcome == "drop":
+            # Never answered: vice-out stays until the client gives up and sends another call
+            self.ignore = (stat.st_mtime_ns, stat.st_size)
+            self.record(devicespec, None)
+            self.log.write(f"{time.strftime('%H:%M:%S')} dropped ({profile['name']}) {url}\n")
+            self.log.flush()
+            print(f"[{self.name}] {url} -> dropped ({profile['name']})")
+            return
+        if outcome == "error":
+            payload = bytes()
+        elif outcome == "truncate" and payload:
+            payload = payload[:self.rng.randrange(len(payload))]
+
+        await asyncio.sleep((delay / 2 + 1000 * len(payload) / profile.get("bandwidth", math.inf)) / 1000)
+
+        # The client may have given up on this call (apiAbort) and written the next one over it. That one gets
+        # its own answer, rather than this response and its vice-out removed unread.
+        if self.superseded(stat, request):
+            self.again = True
+            self.record(devicespec, None)
+            self.log.write(f"{time.strftime('%H:%M:%S')} superseded {url}\n")
+            self.log.flush()
+            print(f"[{self.name}] {url} -> superseded by a newer call")
+            return
+
+        # Write under a temp name first, so the C64 never sees part of a response
+        temp_file = self.out_file + ".tmp"
+        with open(temp_file, "wb") as file:
+            file.write(payload)
+        os.replace(temp_file, self.out_file)
+
+        # The C64 waits for vice-out to go away. Check again right before, as the client runs on meanwhile.
+        if self.superseded(stat, request):
+            self.again = True
+            self.record(devicespec, None)
+            print(f"[{self.name}] {url} -> superseded by a newer call")
+            return
+        os.remove(self.watch_file)
+        self.record(devicespec, payload)
+
+        ms = (time.perf_counter() - start) * 1000
+        self.latencies.append(ms)
+        self.bytes += len(payload)
+        note = f" {outcome} ({profile['name']})" if outcome else ""
+        self.log.write(f"{time.strftime('%H:%M:%S')} {ms:7.1f} ms {len(payload):5} bytes {url}{note}\n")
+        self.log.flush()
+        print(f"[{self.name}] {url} -> {len(payload)} bytes in {ms:.1f} ms{note}")
+        if not self.quiet:
+            hexdump(payload)
+
+    def record(self, devicespec, payload):
+        """Appends a call to the capture, payload None if it was never answered"""
+        if not self.capture:
+            return
+        url = devicespec.encode()
+        ms = int((time.monotonic() - self.capture_start) * 1000)
+        self.capture.write(CAPTURE_RECORD.pack(ms, len(url), CAPTURE_NO_RESPONSE if payload is None else len(payload)))
+        self.capture.write(url + (payload or b""))
+        self.capture.flush()
+
+    def delay(self, profile, sent):
+        """Simulated round trip in ms for this call, before the response's transfer time"""
+        ms = sample_latency(profile["latency"], self.rng) if "latency" in profile else 0.0
+        chance, stall = profile.get("spike", (0, 0))
+        if self.rng.random() < chance:
+            ms += stall
+        return ms + 1000 * sent / profile.get("bandwidth", math.inf)
+
+    def outcome(self, profile):
+        """Which failure, if any, this call suffers: drop, error or truncate"""
+        roll = self.rng.random()
+        for kind in ("drop", "error", "truncate"):
+            roll -= profile.get(kind, 0)
+            if roll < 0:
+                self.injected[kind] += 1
+                return kind
+        return None
+
+    def stats(self):
+        if not self.latencies:
+            return f"{self.name:>12}: no calls"
+        ordered = sorted(self.latencies)
+
+        def pick(p):
+            return ordered[min(len(ordered) - 1, int(len(ordered) * p))]
 
-prevWatchFileCtime = 0
-waitMinAmount = 0.050
-waitMaxAmount = 0.200
-waitAmount = waitMinAmount
+        injected = "".join(f" {count} {kind}" for kind, count in self.injected.items() if count)
+        return (f"{self.name:>12}: {len(ordered):6} calls {self.errors:4} errors {self.bytes:9} bytes"
+                f"  p50 {pick(0.50):7.1f}  p95 {pick(0.95):7.1f}  max {ordered[-1]:7.1f} ms"
+                + (f"  injected:{injected}" if injected else ""))
 
-print(f"Watching: {watchFile}")
 
-try:
-    while True:
-        if os.path.exists(watchFile) and os.path.getsize(watchFile) > 0 and os.path.getctime(watchFile) != prevWatchFileCtime:
+class Bridge:
+    def __init__(self, instances):
+        self.instances = instances
+        self.tasks = set()
+
+    def spawn(self, coro):
+        # Keep a reference, so the task is not collected while it waits
+        task = asyncio.ensure_future(coro)
+        self.tasks.add(task)
+        task.add_done_callback(self.tasks.discard)
+
+    def watch_inotify(self, loop):
+        """Watches every folder through one inotify descriptor. Returns False if inotify is not available."""
+        libc_name = ctypes.util.find_library("c")
+        libc = ctypes.CDLL(libc_name, use_errno=True) if libc_name else None
+        if libc is None or not hasattr(libc, "inotify_init1"):
+            return False
+
+        fd = libc.inotify_init1(IN_NONBLOCK)
+        if fd < 0:
+            return False
+        by_wd = {}
+        for instance in self.instances:
+            wd = libc.inotify_add_watch(fd, instance.path.encode(), IN_CLOSE_WRITE | IN_MOVED_TO)
+            if wd < 0:
+                os.close(fd)
+                return False
+            by_wd[wd] = instance
+
+        def on_events():
             try:
-                with open(watchFile, 'a') as f:
-                    writable = f.writable()
-                if writable:
-                    prevWatchFileCtime = os.path.getctime(watchFile)
-                    waitAmount=waitMinAmount
-                    processWatchFile()
+                data = os.read(fd, 16384)
+            except BlockingIOError:
+                return
+            offset, ready = 0, set()
+            while offset < len(data):
+                wd, _, _, name_len = INOTIFY_EVENT.unpack_from(data, offset)
+                name = data[offset + INOTIFY_EVENT.size: offset + INOTIFY_EVENT.size + name_len].rstrip(b"\0")
+                offset += INOTIFY_EVENT.size + name_len
+                if name == WATCH_FILE.encode() and wd in by_wd:
+                    ready.add(by_wd[wd])
+            for instance in ready:
+                self.spawn(instance.process())
+
+        loop.add_reader(fd, on_events)
+        return True
+
+    async def poll(self, instance):
+        last = None
+        while True:
+            try:
+                stat = os.stat(instance.watch_file)
+                # Wait for a write to settle, VICE writes the file as the C64 sends it
+                if stat.st_size and (stat.st_mtime_ns, stat.st_size) == last and not instance.busy:
+                    self.spawn(instance.process())
+                    last = None
                 else:
-                    waitAmount = min(waitAmount + waitMinAmount, waitMaxAmount) 
-            except IOError:
-                time.sleep(waitMinAmount)
-           
-
-        time.sleep(waitMinAmount)  #  waitMinAmount
-except KeyboardInterrupt:
-    print("Exiting")
-iface.close()
+                    last = (stat.st_mtime_ns, stat.st_size)
+            except OSError:
+                last = None
+            await asyncio.sleep(POLL_SECONDS)
+
+    def print_stats(self):
+        print("Latency per instance:")
+        for instance in self.instances:
+            print(instance.stats())
+
+    async def run(self, stats_seconds):
+        if self.watch_inotify(asyncio.get_running_loop()):
+            print("Watching (inotify):")
+        else:
+            print(f"Watching (polling every {POLL_SECONDS * 1000:.0f} ms):")
+            for instance in self.instances:
+                self.spawn(self.poll(instance))
+
+        for instance in self.instances:
+            print(f"  {instance.watch_file}")
+            self.spawn(instance.process())  # A call made before the bridge started
+
+        while True:
+            await asyncio.sleep(stats_seconds or 3600)
+            if stats_seconds:
+                self.print_stats()
+
+
+if __name__ == "__main__":
+    parser = argparse.ArgumentParser(description="Mock FujiNet network bridge for VICE")
+    parser.add_argument("--path", action="append", help="folder drive 11 points at, once per VICE instance (default: .)")
+    parser.add_argument("--instances", type=int, default=0, help="serve PATH/player1..N instead, creating the folders")
+    parser.add_argument("--local", help="send every call to this server instead, e.g. http://127.0.0.1:8080/")
+    parser.add_argument("--stats", type=float, default=0, help="print latency per instance every SECONDS")
+    parser.add_argument("--quiet", action="store_true", help="do not hexdump responses")
+    parser.add_argument("--conditions", help="simulate network conditions: a profile or scenario name")
+    parser.add_argument("--profiles", default=PROFILES_FILE, help="profiles and scenarios file (default: netprofiles.json)")
+    parser.add_argument("--seed", type=int, help="seed for the simulated conditions, for repeatable runs")
+    parser.add_argument("--capture", help="record each instance's calls to this file in its folder, for make replay")
+    args = parser.parse_args()
+
+    paths = [os.path.abspath(p) for p in (args.path or [os.getcwd()])]
+    if args.instances:
+        paths = [os.path.join(paths[0], f"player{i + 1}") for i in range(args.instances)]
+        for path in paths:
+            os.makedirs(path, exist_ok=True)
+
+    print("Mock FujiNet Network Bridge")
+    print("-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-")
+
+    local = urlsplit(args.local) if args.local else None
+    conditions = Conditions(args.profiles, args.conditions) if args.conditions else None
+    if conditions:
+        print(f"Simulating network conditions: {args.conditions}")
+    bridge = Bridge([Instance(path, local, args.quiet, conditions, None if args.seed is None else args.seed + i,
+                              args.capture)
+                     for i, path in enumerate(paths)])
+    try:
+        asyncio.run(bridge.run(args.stats))
+    except KeyboardInterrupt:
+        bridge.print_stats()
+        print("Exiting")
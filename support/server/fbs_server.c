@@ -0,0 +1,1500 @@
+/*
+  Local stand-in for the Fuji Battleship server, in C.
+
+  Serves the tables, state, ready, place/..., attack/N, leave and stats/... endpoints with the
+  bin=1 layouts of Tables, Lobby and Game, over http as fbs_server.py does for each version:
+    v2: the raw layouts, a byte per gamefield cell, every player slot sent
+    v3: [type][caps][seq lo][seq hi] header, then the layout in full or as a patch
+        against the payload the client has (&seq=N)
+    v4: gamefields packed 2 bits per cell, only playerCount players sent
+    v5: [hint lo][hint hi] poll hint added to the header
+    v6: a session token follows the header once, after which calls are s/<token>[/path]?seq=N
+  "state" calls with &wait=N are held until the table changes (long-poll), except with --lockstep.
+  The push datagrams and binary sessions of fbs_server.py are not offered.
+  The game rules and timings match fbs_server.py.
+
+  A single epoll loop serves every connection, keep-alive and pipelined requests included.
+  Games are seeded, so turn order, bot placements and bot moves repeat from run to run.
+  With --lockstep the game clock also stops following the wall clock and moves a tick
+  (250ms) per request instead, so the same requests always get the same responses,
+  and a harness can play full games as fast as it can send them.
+
+  Build: make server
+  Usage: r2r/host/fbs_server [--port 8080] [--bots 1] [--tables 3] [--seed 1] [--lockstep] [--stats 30] [--verbose]
+
+  Point a client at it by setting the first byte of the e41c0500 appkey to 0xff
+  (see localServer in src/main.c).
+*/
+
+#define _GNU_SOURCE
+#include <ctype.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <errno.h>
+#include <signal.h>
+#include <time.h>
+#include <unistd.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/epoll.h>
+#include <sys/socket.h>
+
+// Mirrors src/misc.h
+#define PLAYER_MAX 4
+#define FIELD_CELLS 100
+
+#define STATUS_LOBBY 0
+#define STATUS_PLACE_SHIPS 1
+#define STATUS_GAMESTART 10
+#define STATUS_MISS 11
+#define STATUS_HIT 12
+#define STATUS_SUNK 13
+#define STATUS_GAMEOVER 99
+
+#define PLAYER_STATUS_DEFAULT 0
+#define PLAYER_STATUS_DEFEATED 1
+#define PLAYER_STATUS_VIEWING 2
+#define PLAYER_STATUS_READY 3
+#define PLAYER_STATUS_PLACE_SHIPS 10
+
+#define FIELD_ATTACK 1
+#define FIELD_MISS 2
+
+// Game clock, in jiffies as on the clients
+#define JIFFIES 60
+#define TICK (JIFFIES / 4) // How often tables advance on their own
+#define COUNTDOWN_TIME (5 * JIFFIES)
+#define MOVE_SECONDS 20
+#define MOVE_TIME (MOVE_SECONDS * JIFFIES)
+#define GAMEOVER_TIME (15 * JIFFIES)
+#define BOT_DELAY (3 * JIFFIES / 2)
+
+// Mirrors src/stateclient.h
+#define API_RESP_FULL 0xF0
+#define API_RESP_PATCH 0xF1
+#define API_PATCH_MAX 128 // Larger patches go out in full, as on fbs_server.py
+#define API_CAP_LONGPOLL 0x01
+#define API_CAP_TOKEN 0x04
+#define API_TOKEN_SIZE 4
+
+#define SEQ_WRAP 0x7FFF    // Clients send seq as a signed int
+#define HISTORY 4          // Payloads kept per player to patch against
+#define LONGPOLL_MAX 15    // Longest a state call is held, in seconds
+#define FIELD_PACKED_SIZE 25
+
+#define TABLE_MAX 256
+#define TABLE_LIST_MAX 10 // Tables fit in the tables layout
+#define VIEWER_MAX 16
+#define CONN_IN 2048
+#define CONN_OUT 8192
+#define ENDPOINT_COUNT 8
+#define SESSION_MAX (TABLE_MAX * (PLAYER_MAX + VIEWER_MAX))
+#define HELD_MAX 4096
+#define HELD 0xFFFF // handle() held the call
+
+/* The v2 wire layouts. All fields are bytes, so there is no padding. */
+
+typedef struct
+{
+    char table[9];
+    char name[21];
+    char players[6];
+} WireTable;
+
+typedef struct
+{
+    uint8_t count;
+    WireTable table[10];
+} WireTables;
+
+typedef struct
+{
+    char name[9];
+    uint8_t ready;
+} WireLobbyPlayer;
+
+typedef struct
+{
+    uint8_t playerCount;
+    char prompt[33];
+    uint8_t status;
+    uint8_t playerStatus;
+    int8_t activePlayer;
+    uint8_t moveTime;
+    char serverName[21];
+    WireLobbyPlayer players[PLAYER_MAX];
+} WireLobby;
+
+typedef struct
+{
+    char name[9];
+    uint8_t playerStatus;
+    uint8_t gamefield[FIELD_CELLS];
+    uint8_t shipsLeft[5];
+} WirePlayer;
+
+typedef struct
+{
+    uint8_t playerCount;
+    char prompt[33];
+    uint8_t status;
+    uint8_t playerStatus;
+    int8_t activePlayer;
+    uint8_t moveTime;
+    uint8_t lastAttackPos;
+    uint8_t myShips[10];
+    WirePlayer players[PLAYER_MAX];
+} WireGame;
+
+_Static_assert(sizeof(WireTables) == 361, "Tables layout");
+_Static_assert(sizeof(WireLobby) == 99, "Lobby layout");
+_Static_assert(sizeof(WireGame) == 509, "v2 Game layout");
+
+// Largest body: header, token and the v2 Game layout
+#define BODY_MAX (6 + API_TOKEN_SIZE + sizeof(WireGame))
+
+/* Game engine */
+
+typedef struct
+{
+    char name[9];
+    bool bot, ready, placed;
+    uint8_t status;
+    uint8_t ships[5];
+    uint8_t field[FIELD_CELLS];
+    uint8_t shipsLeft[5];
+    uint16_t sentSeq[HISTORY]; // Table seq each payload kept was sent at, 0 if none
+    uint16_t sentLen[HISTORY];
+    uint8_t sentNext;
+    uint8_t sent[HISTORY][sizeof(WireGame)];
+} Player;
+
+typedef struct
+{
+    char id[9], name[21];
+    Player players[PLAYER_MAX];
+    Player viewers[VIEWER_MAX];
+    uint8_t playerCount, viewerCount;
+    uint8_t status, lastAttack, countdown;
+    int8_t active, winner;
+    char prompt[33];
+    uint32_t deadline; // 0 if none
+    uint16_t seq;      // Bumped on every change, 1 to SEQ_WRAP
+} Table;
+
+typedef struct
+{
+    uint16_t table; // Index into tables
+    char name[9];
+} Session;
+
+typedef struct
+{
+    int fd;
+    uint16_t inLen;
+    uint32_t outLen, outPos;
+    bool closing;
+    bool held, waited; // The first request is held for a change, or was and is answered now
+    Table *heldTable;
+    uint16_t heldSeq;
+    uint64_t heldUntil; // wallMillis()
+    char in[CONN_IN];
+    uint8_t out[CONN_OUT];
+} Conn;
+
+static const uint8_t shipSize[5] = {5, 4, 3, 3, 2};
+
+static const char *endpoints[ENDPOINT_COUNT] = {"tables", "state", "ready", "place", "attack", "leave", "stats", "other"};
+
+// --tables adds t4, t5.. after these, for load tests
+static Table tables[TABLE_MAX] = {
+    {.id = "basement", .name = "Basement Boat"},
+    {.id = "sea", .name = "Open Sea"},
+    {.id = "dev", .name = "Dev Table"}};
+static size_t tableCount = 3;
+
+// A v6 token spells its index here in base 36
+static Session sessions[SESSION_MAX];
+static uint16_t sessionCount;
+static const char tokenChars[] = "abcdefghijklmnopqrstuvwxyz0123456789";
+
+static Conn *held[HELD_MAX];
+static size_t heldCount;
+static bool tableChanged; // Held calls may be answered
+
+static uint32_t now;  // Game clock in jiffies
+static uint32_t seed = 1;
+static bool lockstep, verbose;
+static volatile sig_atomic_t stopping;
+
+static struct
+{
+    uint32_t requests[ENDPOINT_COUNT];
+    uint64_t bytes[ENDPOINT_COUNT];
+    uint32_t connections, notFound;
+} stats;
+
+static uint32_t rnd(uint32_t range)
+{
+    // xorshift32 - a fixed sequence per seed on every host
+    seed ^= seed << 13;
+    seed ^= seed >> 17;
+    seed ^= seed << 5;
+    return seed % range;
+}
+
+/// @brief Fixed size, zero padded and terminated string field
+static void setText(char *dest, size_t size, const char *s)
+{
+    memset(dest, 0, size);
+    memcpy(dest, s, strnlen(s, size - 1));
+}
+
+/// @brief Bumps the table's seq, so clients get the change rather than a patch against what they have
+static void changed(Table *t)
+{
+    t->seq = t->seq < SEQ_WRAP ? t->seq + 1 : 1;
+    tableChanged = true;
+}
+
+/// @brief Returns the next cell a ship covers from pos (add 100 for vertical), as placeShip() in gamelogic.c
+static uint8_t nextCell(uint8_t pos)
+{
+    return pos + (pos >= 100 ? 10 : 1);
+}
+
+/// @brief Same rules as testShip() in gamelogic.c, for all 5 ships
+static bool validPlacement(const uint8_t *ships)
+{
+    uint8_t used[FIELD_CELLS] = {0};
+    uint8_t i, j, pos;
+
+    for (i = 0; i < 5; i++)
+    {
+        pos = ships[i];
+        for (j = 0; j < shipSize[i]; j++)
+        {
+            if (pos > 199 || (j > 0 && pos <= 100 && pos % 10 == 0) || used[pos % 100])
+                return false;
+            used[pos % 100] = 1;
+            pos = nextCell(pos);
+        }
+    }
+    return true;
+}
+
+static void randomPlacement(uint8_t *ships)
+{
+    uint8_t i;
+
+    do
+    {
+        for (i = 0; i < 5; i++)
+            ships[i] = (uint8_t)rnd(200);
+    } while (!validPlacement(ships));
+}
+
+static void resetPlayer(Player *p)
+{
+    p->ready = p->bot;
+    p->placed = false;
+    p->status = PLAYER_STATUS_DEFAULT;
+    memset(p->ships, 0, sizeof(p->ships));
+    memset(p->field, 0, sizeof(p->field));
+    memset(p->shipsLeft, 1, sizeof(p->shipsLeft));
+}
+
+static void resetTable(Table *t)
+{
+    uint8_t i;
+
+    t->status = STATUS_LOBBY;
+    setText(t->prompt, sizeof(t->prompt), "waiting for players");
+    t->active = t->winner = -1;
+    t->lastAttack = 0;
+    t->deadline = t->countdown = 0;
+    for (i = 0; i < t->playerCount; i++)
+        resetPlayer(&t->players[i]);
+}
+
+static Table *findTable(const char *id)
+{
+    size_t i;
+
+    for (i = 0; i < tableCount; i++)
+    {
+        if (!strcmp(tables[i].id, id))
+            return &tables[i];
+    }
+    return NULL;
+}
+
+static Player *findPlayer(Table *t, const char *name)
+{
+    uint8_t i;
+
+    for (i = 0; i < t->playerCount; i++)
+    {
+        if (!strcmp(t->players[i].name, name))
+            return &t->players[i];
+    }
+    for (i = 0; i < t->viewerCount; i++)
+    {
+        if (!strcmp(t->viewers[i].name, name))
+            return &t->viewers[i];
+    }
+    return NULL;
+}
+
+/// @brief Seats a new player in the lobby, or as a viewer once the game started or the table is full. NULL if there is no room to watch either.
+static Player *join(Table *t, const char *name)
+{
+    Player *p = findPlayer(t, name);
+
+    if (p)
+        return p;
+
+    if (t->status == STATUS_LOBBY && t->playerCount < PLAYER_MAX)
+        p = &t->players[t->playerCount++];
+    else if (t->viewerCount < VIEWER_MAX)
+        p = &t->viewers[t->viewerCount++];
+    else
+        return NULL;
+
+    memset(p, 0, sizeof(Player));
+    setText(p->name, sizeof(p->name), name);
+    resetPlayer(p);
+    if (p >= t->viewers)
+        p->status = PLAYER_STATUS_VIEWING;
+    changed(t);
+    return p;
+}
+
+static bool alive(const Player *p)
+{
+    return p->status == PLAYER_STATUS_DEFAULT;
+}
+
+static void nextTurn(Table *t)
+{
+    uint8_t i;
+
+    for (i = 0; i < t->playerCount; i++)
+    {
+        t->active = (t->active + 1) % t->playerCount;
+        if (alive(&t->players[t->active]))
+            break;
+    }
+    t->deadline = now + MOVE_TIME;
+}
+
+static bool checkWinner(Table *t)
+{
+    uint8_t i, count = 0;
+
+    if (t->status < STATUS_GAMESTART)
+        return false;
+
+    for (i = 0; i < t->playerCount; i++)
+    {
+        if (alive(&t->players[i]))
+        {
+            t->winner = i;
+            count++;
+        }
+    }
+    if (count > 1)
+        return false;
+
+    if (!count)
+        t->winner = -1;
+    t->status = STATUS_GAMEOVER;
+    t->active = t->winner;
+    if (t->winner >= 0)
+        snprintf(t->prompt, sizeof(t->prompt), "%s won", t->players[t->winner].name);
+    else
+        setText(t->prompt, sizeof(t->prompt), "game over");
+    t->deadline = now + GAMEOVER_TIME;
+    return true;
+}
+
+/// @brief The player leaves, returning a copy of them as they were, for the response
+static Player *leave(Table *t, Player *p)
+{
+    static Player left;
+    uint8_t i;
+
+    left = *p;
+    changed(t);
+    if (p >= t->viewers)
+    {
+        i = (uint8_t)(p - t->viewers);
+        memmove(p, p + 1, (t->viewerCount - i - 1) * sizeof(Player));
+        t->viewerCount--;
+    }
+    else if (t->status == STATUS_LOBBY)
+    {
+        i = (uint8_t)(p - t->players);
+        memmove(p, p + 1, (t->playerCount - i - 1) * sizeof(Player));
+        t->playerCount--;
+    }
+    else
+    {
+        p->status = PLAYER_STATUS_DEFEATED;
+        checkWinner(t);
+        return p;
+    }
+
+    left.ready = false;
+    left.status = PLAYER_STATUS_DEFAULT;
+    return &left;
+}
+
+static void startPlacement(Table *t)
+{
+    uint8_t i;
+
+    t->status = STATUS_PLACE_SHIPS;
+    setText(t->prompt, sizeof(t->prompt), "place your ships");
+    for (i = 0; i < t->playerCount; i++)
+        t->players[i].status = PLAYER_STATUS_PLACE_SHIPS;
+}
+
+static void place(Table *t, Player *p, const uint8_t *ships)
+{
+    uint8_t i;
+
+    if (t->status != STATUS_PLACE_SHIPS || p >= t->viewers || !validPlacement(ships))
+        return;
+
+    memcpy(p->ships, ships, sizeof(p->ships));
+    p->placed = true;
+    p->status = PLAYER_STATUS_DEFAULT;
+
+    for (i = 0; i < t->playerCount && t->players[i].placed; i++)
+        ;
+    if (i == t->playerCount)
+    {
+        t->status = STATUS_GAMESTART;
+        t->active = (int8_t)rnd(t->playerCount);
+        t->deadline = now + MOVE_TIME;
+        t->prompt[0] = 0;
+    }
+    else
+    {
+        setText(t->prompt, sizeof(t->prompt), "waiting on other players");
+    }
+    changed(t);
+}
+
+static bool shipCovers(uint8_t ship, uint8_t size, uint8_t pos)
+{
+    while (size--)
+    {
+        if (ship % 100 == pos)
+            return true;
+        ship = nextCell(ship);
+    }
+    return false;
+}
+
+static bool shipSunk(const Player *p, uint8_t i)
+{
+    uint8_t j, pos = p->ships[i];
+
+    for (j = 0; j < shipSize[i]; j++)
+    {
+        if (p->field[pos % 100] != FIELD_ATTACK)
+            return false;
+        pos = nextCell(pos);
+    }
+    return true;
+}
+
+static void attack(Table *t, Player *p, int pos)
+{
+    Player *target;
+    uint8_t i, j;
+    bool hit = false, sunk = false, covered;
+
+    if (t->status < STATUS_GAMESTART || t->status == STATUS_GAMEOVER)
+        return;
+    if (p != &t->players[t->active] || pos < 0 || pos >= FIELD_CELLS)
+        return;
+
+    for (i = 0; i < t->playerCount; i++)
+    {
+        target = &t->players[i];
+        if (target == p || !alive(target) || target->field[pos])
+            continue;
+
+        covered = false;
+        for (j = 0; j < 5 && !covered; j++)
+            covered = shipCovers(target->ships[j], shipSize[j], (uint8_t)pos);
+
+        if (!covered)
+        {
+            target->field[pos] = FIELD_MISS;
+            continue;
+        }
+
+        target->field[pos] = FIELD_ATTACK;
+        hit = true;
+        for (j = 0; j < 5; j++)
+        {
+            if (target->shipsLeft[j] && shipSunk(target, j))
+            {
+                target->shipsLeft[j] = 0;
+                sunk = true;
+            }
+        }
+        if (!memchr(target->shipsLeft, 1, 5))
+            target->status = PLAYER_STATUS_DEFEATED;
+    }
+
+    t->lastAttack = (uint8_t)pos;
+    t->status = sunk ? STATUS_SUNK : hit ? STATUS_HIT : STATUS_MISS;
+    if (!checkWinner(t))
+        nextTurn(t);
+    changed(t);
+}
+
+static uint8_t botTarget(Table *t)
+{
+    static uint8_t open[FIELD_CELLS];
+    uint8_t pos, i, count = 0;
+
+    for (pos = 0; pos < FIELD_CELLS; pos++)
+    {
+        for (i = 0; i < t->playerCount; i++)
+        {
+            if (i != t->active && alive(&t->players[i]) && !t->players[i].field[pos])
+            {
+                open[count++] = pos;
+                break;
+            }
+        }
+    }
+    return count ? open[rnd(count)] : 0;
+}
+
+/// @brief Advances the table on its own: lobby countdown, bot placements and moves, move timeouts and the game over pause
+static void tick(Table *t)
+{
+    uint8_t i, ready = 0, seconds;
+
+    switch (t->status)
+    {
+    case STATUS_LOBBY:
+        for (i = 0; i < t->playerCount; i++)
+            ready += t->players[i].ready;
+
+        if (t->playerCount > 1 && ready == t->playerCount)
+        {
+            if (!t->deadline)
+                t->deadline = now + COUNTDOWN_TIME;
+            seconds = t->deadline > now ? (t->deadline - now + JIFFIES - 1) / JIFFIES : 0;
+            if (!seconds)
+            {
+                startPlacement(t);
+                changed(t);
+            }
+            else if (seconds != t->countdown)
+            {
+                t->countdown = seconds;
+                snprintf(t->prompt, sizeof(t->prompt), "starting in %d", seconds);
+                changed(t);
+            }
+        }
+        else if (t->deadline)
+        {
+            t->deadline = t->countdown = 0;
+            setText(t->prompt, sizeof(t->prompt), "waiting for players");
+            changed(t);
+        }
+        break;
+
+    case STATUS_PLACE_SHIPS:
+        for (i = 0; i < t->playerCount; i++)
+        {
+            if (t->players[i].bot && !t->players[i].placed)
+            {
+                static uint8_t ships[5];
+
+                randomPlacement(ships);
+                place(t, &t->players[i], ships);
+            }
+        }
+        break;
+
+    case STATUS_GAMEOVER:
+        if (now > t->deadline)
+        {
+            resetTable(t);
+            changed(t);
+        }
+        break;
+
+    default:
+        if (t->players[t->active].bot && now > t->deadline - MOVE_TIME + BOT_DELAY)
+            attack(t, &t->players[t->active], botTarget(t));
+        else if (now > t->deadline)
+        {
+            nextTurn(t);
+            changed(t);
+        }
+        break;
+    }
+}
+
+static void tickAll()
+{
+    size_t i;
+
+    for (i = 0; i < tableCount; i++)
+        tick(&tables[i]);
+}
+
+/* Payloads */
+
+/// @brief Index of the table's player i as seen by p, who is always index 0 when seated
+static uint8_t viewIndex(const Table *t, const Player *p, uint8_t i)
+{
+    if (p >= t->players && p < t->players + t->playerCount)
+        return (uint8_t)((i + (p - t->players)) % t->playerCount);
+    return i;
+}
+
+static uint16_t tablesPayload(uint8_t *buf)
+{
+    WireTables *w = (WireTables *)buf;
+    size_t i;
+
+    memset(w, 0, sizeof(WireTables));
+    w->count = tableCount < TABLE_LIST_MAX ? tableCount : TABLE_LIST_MAX;
+    for (i = 0; i < w->count; i++)
+    {
+        setText(w->table[i].table, sizeof(w->table[i].table), tables[i].id);
+        setText(w->table[i].name, sizeof(w->table[i].name), tables[i].name);
+        snprintf(w->table[i].players, sizeof(w->table[i].players), "%d/%d", tables[i].playerCount, PLAYER_MAX);
+    }
+
+    // Only the tables there are
+    return 1 + w->count * sizeof(WireTable);
+}
+
+static uint16_t lobbyPayload(const Table *t, const Player *p, uint8_t *buf)
+{
+    WireLobby *w = (WireLobby *)buf;
+    const Player *other;
+    uint8_t i;
+
+    memset(w, 0, sizeof(WireLobby));
+    w->playerCount = t->playerCount;
+    setText(w->prompt, sizeof(w->prompt), t->prompt);
+    w->status = STATUS_LOBBY;
+    w->playerStatus = p->ready ? PLAYER_STATUS_READY : p->status;
+    w->activePlayer = -1;
+    setText(w->serverName, sizeof(w->serverName), t->name);
+    for (i = 0; i < t->playerCount; i++)
+    {
+        other = &t->players[viewIndex(t, p, i)];
+        setText(w->players[i].name, sizeof(w->players[i].name), other->name);
+        w->players[i].ready = other->ready;
+    }
+    return sizeof(WireLobby);
+}
+
+/// @brief Game layout for p, the v4 one (gamefields packed, only playerCount players) if packed
+static uint16_t gamePayload(const Table *t, const Player *p, uint8_t *buf, bool packed)
+{
+    static WireGame unpacked;
+    WireGame *w = packed ? &unpacked : (WireGame *)buf;
+    const Player *other;
+    uint8_t i, j, *out;
+
+    memset(w, 0, sizeof(WireGame));
+    w->playerCount = t->playerCount;
+    setText(w->prompt, sizeof(w->prompt), t->prompt);
+    w->status = t->status;
+    w->playerStatus = p->status;
+    w->activePlayer = -1;
+    w->moveTime = MOVE_SECONDS;
+    w->lastAttackPos = t->lastAttack;
+    if (p->placed)
+        memcpy(w->myShips, p->ships, 5);
+    if (t->status == STATUS_GAMEOVER && t->winner >= 0)
+        memcpy(w->myShips + 5, t->players[t->winner].ships, 5);
+
+    for (i = 0; i < t->playerCount; i++)
+    {
+        other = &t->players[viewIndex(t, p, i)];
+        if (t->active >= 0 && other == &t->players[t->active])
+            w->activePlayer = i;
+        setText(w->players[i].name, sizeof(w->players[i].name), other->name);
+        w->players[i].playerStatus = other->status;
+        memcpy(w->players[i].gamefield, other->field, FIELD_CELLS);
+        memcpy(w->players[i].shipsLeft, other->shipsLeft, 5);
+    }
+    if (!packed)
+        return sizeof(WireGame);
+
+    // Each player: name and playerStatus, the gamefield at 4 cells a byte (first cell in the low bits), shipsLeft
+    memcpy(buf, w, offsetof(WireGame, players));
+    out = buf + offsetof(WireGame, players);
+    for (i = 0; i < w->playerCount; i++)
+    {
+        memcpy(out, w->players[i].name, offsetof(WirePlayer, gamefield));
+        out += offsetof(WirePlayer, gamefield);
+        memset(out, 0, FIELD_PACKED_SIZE);
+        for (j = 0; j < FIELD_CELLS; j++)
+            out[j >> 2] |= (uint8_t)((w->players[i].gamefield[j] & 3) << ((j & 3) << 1));
+        out += FIELD_PACKED_SIZE;
+        memcpy(out, w->players[i].shipsLeft, 5);
+        out += 5;
+    }
+    return (uint16_t)(out - buf);
+}
+
+/// @brief Jiffies until the table next changes on its own, for the v5 poll hint. 0 if that depends on a player.
+static uint16_t pollHint(const Table *t, const Player *p)
+{
+    uint32_t due;
+
+    if (t->status == STATUS_LOBBY)
+    {
+        if (!t->deadline)
+            return 0;
+        due = now + JIFFIES;
+    }
+    else if (t->status == STATUS_GAMEOVER)
+        due = t->deadline;
+    else if (t->status >= STATUS_GAMESTART && t->players[t->active].bot)
+        due = t->deadline - MOVE_TIME + BOT_DELAY;
+    else if (t->status >= STATUS_GAMESTART && p == &t->players[t->active])
+        due = t->deadline;
+    else
+        return 0;
+
+    // Tables only advance on a tick
+    due = due + TICK > now ? due + TICK - now : 0;
+    return due < 0xFFFF ? (uint16_t)due + 1 : 0xFFFF;
+}
+
+/*
+  Writes the patch records ([offset lo][offset hi][len][len bytes]) that turn old into cur to out.
+  Changes a few equal bytes apart share a record, as a record header costs 3.
+  Returns the size, or more than max if the patch would not fit.
+*/
+static uint16_t makePatch(const uint8_t *old, const uint8_t *cur, uint16_t len, uint8_t *out, uint16_t max)
+{
+    uint16_t i = 0, start, end, size = 0;
+
+    while (i < len)
+    {
+        if (old[i] == cur[i])
+        {
+            i++;
+            continue;
+        }
+        start = end = i;
+        while (i < len && i - end <= 3 && i - start < 255)
+        {
+            if (old[i] != cur[i])
+                end = i + 1;
+            i++;
+        }
+        if (size + 3 + end - start > max)
+            return max + 1;
+        out[size++] = start & 0xFF;
+        out[size++] = start >> 8;
+        out[size++] = (uint8_t)(end - start);
+        memcpy(out + size, cur + start, end - start);
+        size += end - start;
+        i = end;
+    }
+    return size;
+}
+
+/// @brief Keeps the payload p was sent at seq, in place of the oldest one kept
+static void remember(Player *p, uint16_t seq, const uint8_t *payload, uint16_t len)
+{
+    uint8_t i;
+
+    for (i = 0; i < HISTORY && p->sentSeq[i] != seq; i++)
+        ;
+    if (i == HISTORY)
+    {
+        i = p->sentNext;
+        p->sentNext = (p->sentNext + 1) % HISTORY;
+    }
+    p->sentSeq[i] = seq;
+    p->sentLen[i] = len;
+    memcpy(p->sent[i], payload, len);
+}
+
+/*
+  Writes the body for a client of the given version to buf: the payload as is for v2, otherwise behind
+  the v3+ header, as a patch when p was sent a payload of the same size at the client's seq.
+  t and p are NULL for the tables list. Returns the body size.
+*/
+static uint16_t encode(Table *t, Player *p, const uint8_t *payload, uint16_t len, uint8_t version, uint16_t seq, const char *token, uint8_t *buf)
+{
+    uint8_t *out = buf + 4, i;
+    uint16_t hint, size;
+
+    if (version < 3)
+    {
+        memcpy(buf, payload, len);
+        return len;
+    }
+
+    buf[0] = API_RESP_FULL;
+    buf[1] = lockstep ? 0 : API_CAP_LONGPOLL;
+    buf[2] = t ? t->seq & 0xFF : 0;
+    buf[3] = t ? t->seq >> 8 : 0;
+    if (version >= 5)
+    {
+        hint = t ? pollHint(t, p) : 0;
+        *out++ = hint & 0xFF;
+        *out++ = hint >> 8;
+    }
+    if (token)
+    {
+        buf[1] |= API_CAP_TOKEN;
+        memcpy(out, token, API_TOKEN_SIZE);
+        out += API_TOKEN_SIZE;
+    }
+
+    if (t)
+    {
+        for (i = 0; i < HISTORY && (!seq || p->sentSeq[i] != seq || p->sentLen[i] != len); i++)
+            ;
+        size = i < HISTORY ? makePatch(p->sent[i], payload, len, out, API_PATCH_MAX) : API_PATCH_MAX + 1;
+        remember(p, t->seq, payload, len);
+        if (size <= API_PATCH_MAX)
+        {
+            buf[0] = API_RESP_PATCH;
+            return (uint16_t)(out - buf) + size;
+        }
+    }
+
+    memcpy(out, payload, len);
+    return (uint16_t)(out - buf) + len;
+}
+
+/// @brief The v6 session token of the table's player, issued on first use. NULL once every token is taken.
+static const char *tokenFor(const Table *t, const char *name)
+{
+    static char token[API_TOKEN_SIZE];
+    uint32_t i, n;
+    uint8_t j;
+
+    for (i = 0; i < sessionCount; i++)
+    {
+        if (sessions[i].table == t - tables && !strcmp(sessions[i].name, name))
+            break;
+    }
+    if (i == sessionCount)
+    {
+        if (sessionCount == SESSION_MAX)
+            return NULL;
+        sessions[i].table = (uint16_t)(t - tables);
+        setText(sessions[i].name, sizeof(sessions[i].name), name);
+        sessionCount++;
+    }
+
+    for (j = API_TOKEN_SIZE, n = i; j--; n /= 36)
+        token[j] = tokenChars[n % 36];
+    return token;
+}
+
+/// @brief The session a token of API_TOKEN_SIZE characters names, or NULL if none
+static const Session *sessionOf(const char *token)
+{
+    const char *c;
+    uint32_t n = 0;
+    uint8_t j;
+
+    for (j = 0; j < API_TOKEN_SIZE; j++)
+    {
+        if (!token[j] || (c = strchr(tokenChars, token[j])) == NULL)
+            return NULL;
+        n = n * 36 + (uint32_t)(c - tokenChars);
+    }
+    return n < sessionCount ? &sessions[n] : NULL;
+}
+
+/* Requests */
+
+static uint64_t wallMillis()
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
+/// @brief Copies query parameter key into value (url decoded, at most size-1 chars), empty if missing
+static void queryParam(const char *query, const char *key, char *value, size_t size)
+{
+    const char *p = query;
+    size_t keyLen = strlen(key), n = 0;
+    int hex;
+
+    value[0] = 0;
+    while (p && *p)
+    {
+        if (!strncmp(p, key, keyLen) && p[keyLen] == '=')
+        {
+            for (p += keyLen + 1; *p && *p != '&' && n < size - 1; p++)
+            {
+                if (*p == '%' && sscanf(p + 1, "%2x", &hex) == 1)
+                {
+                    value[n++] = (char)hex;
+                    p += 2;
+                }
+                else
+                {
+                    value[n++] = *p == '+' ? ' ' : *p;
+                }
+            }
+            value[n] = 0;
+            return;
+        }
+        p = strchr(p, '&');
+        if (p)
+            p++;
+    }
+}
+
+static uint8_t endpointOf(const char *path)
+{
+    uint8_t i;
+    size_t len;
+
+    for (i = 0; i < ENDPOINT_COUNT - 1; i++)
+    {
+        len = strlen(endpoints[i]);
+        if (!strncmp(path, endpoints[i], len) && (path[len] == 0 || path[len] == '/'))
+            return i;
+    }
+    return ENDPOINT_COUNT - 1;
+}
+
+/// @brief Holds c's first request until t moves past seq or wait seconds pass. False if too many calls are held already.
+static bool hold(Conn *c, Table *t, uint16_t seq, int wait)
+{
+    if (heldCount == HELD_MAX)
+        return false;
+
+    c->held = true;
+    c->heldTable = t;
+    c->heldSeq = seq;
+    c->heldUntil = wallMillis() + (uint64_t)wait * 1000;
+    held[heldCount++] = c;
+    return true;
+}
+
+/*
+  Handles a call on c to path (no leading slash) with query (after the ?), writing the body to buf.
+  session is the one the call's s/<token> named, if any, which stands for its table and player.
+  Returns the body size, 0 for a 404, or HELD if the call waits for a change.
+*/
+static uint16_t handle(Conn *c, const char *path, const char *query, const Session *session, uint8_t *buf)
+{
+    static char tableId[16], name[9], value[8];
+    static uint8_t ships[5], payload[sizeof(WireGame)];
+    Table *t;
+    Player *p;
+    const char *s;
+    char *end;
+    uint16_t seq, len;
+    uint8_t i, version;
+    int wait;
+
+    if (lockstep)
+    {
+        now += TICK;
+        tickAll();
+    }
+
+    queryParam(query, "v", value, sizeof(value));
+    version = session ? 6 : value[0] ? (uint8_t)atoi(value) : 2;
+    queryParam(query, "seq", value, sizeof(value));
+    seq = (uint16_t)atoi(value);
+    queryParam(query, "wait", value, sizeof(value));
+    wait = atoi(value);
+    if (wait > LONGPOLL_MAX)
+        wait = LONGPOLL_MAX;
+
+    if (!strcmp(path, "tables"))
+        return encode(NULL, NULL, payload, tablesPayload(payload), version, 0, NULL, buf);
+
+    if (session)
+    {
+        t = &tables[session->table];
+        strcpy(name, session->name);
+    }
+    else
+    {
+        queryParam(query, "table", tableId, sizeof(tableId));
+        queryParam(query, "player", name, sizeof(name));
+        for (i = 0; name[i]; i++)
+            name[i] = (char)tolower((unsigned char)name[i]);
+        t = findTable(tableId);
+    }
+    if (t == NULL || !name[0])
+        return 0;
+
+    // Long-poll: nothing new for a player the table knows, so answer once there is
+    if (!strcmp(path, "state") && wait > 0 && !lockstep && !c->waited && seq == t->seq && findPlayer(t, name) && hold(c, t, seq, wait))
+        return HELD;
+
+    if ((p = join(t, name)) == NULL)
+        return 0;
+
+    if (!strcmp(path, "ready"))
+    {
+        if (t->status == STATUS_LOBBY && p < t->viewers)
+        {
+            p->ready = !p->ready;
+            changed(t);
+        }
+    }
+    else if (!strncmp(path, "place/", 6))
+    {
+        for (i = 0, s = path + 6; i < 5; i++, s = end + 1)
+        {
+            ships[i] = (uint8_t)strtol(s, &end, 10);
+            if (end == s || (i < 4 && *end != ','))
+                break;
+        }
+        if (i == 5)
+            place(t, p, ships);
+    }
+    else if (!strncmp(path, "attack/", 7))
+    {
+        attack(t, p, atoi(path + 7));
+    }
+    else if (!strcmp(path, "leave"))
+    {
+        p = leave(t, p);
+    }
+    else if (!strncmp(path, "stats/", 6))
+    {
+        // Network stats a client in debug mode sends at the end of a game (queueStatsUpload in src/stateclient.c)
+        printf("client stats from %s: %s\n", name, path + 6);
+        fflush(stdout);
+    }
+
+    tick(t);
+    len = t->status == STATUS_LOBBY ? lobbyPayload(t, p, payload) : gamePayload(t, p, payload, version >= 4);
+    return encode(t, p, payload, len, version, seq, version >= 6 && !session ? tokenFor(t, name) : NULL, buf);
+}
+
+/* Event loop */
+
+static void closeConn(int epfd, Conn *c)
+{
+    size_t i;
+
+    if (c->held)
+    {
+        for (i = 0; held[i] != c; i++)
+            ;
+        held[i] = held[--heldCount];
+    }
+    epoll_ctl(epfd, EPOLL_CTL_DEL, c->fd, NULL);
+    close(c->fd);
+    free(c);
+}
+
+/// @brief Sends what is buffered. Returns false if the connection failed.
+static bool flushConn(int epfd, Conn *c)
+{
+    struct epoll_event ev;
+    ssize_t sent;
+
+    while (c->outPos < c->outLen)
+    {
+        sent = send(c->fd, c->out + c->outPos, c->outLen - c->outPos, MSG_NOSIGNAL);
+        if (sent < 0)
+        {
+            if (errno != EAGAIN)
+                return false;
+
+            // Wait for room, and stop reading requests until then
+            ev.events = EPOLLOUT;
+            ev.data.ptr = c;
+            epoll_ctl(epfd, EPOLL_CTL_MOD, c->fd, &ev);
+            return true;
+        }
+        c->outPos += (uint32_t)sent;
+    }
+
+    c->outLen = c->outPos = 0;
+    ev.events = EPOLLIN;
+    ev.data.ptr = c;
+    epoll_ctl(epfd, EPOLL_CTL_MOD, c->fd, &ev);
+    return !c->closing;
+}
+
+/// @brief Answers every complete request in the input buffer, while there is room to buffer the responses and none is held
+static void answerRequests(Conn *c)
+{
+    static uint8_t body[BODY_MAX];
+    static char request[CONN_IN];
+    const Session *session;
+    char *end, *target, *query, *slash, *path;
+    uint16_t len, used;
+    uint8_t endpoint;
+
+    while (!c->held && c->outLen + 256 + sizeof(body) <= CONN_OUT && (end = memmem(c->in, c->inLen, "\r\n\r\n", 4)) != NULL)
+    {
+        // Parse a copy, as a held request is read again when it is answered
+        used = (uint16_t)(end + 4 - c->in);
+        memcpy(request, c->in, used - 4);
+        request[used - 4] = 0;
+
+        // Keep-alive is the default from HTTP/1.1 on
+        if (strcasestr(request, "\r\nconnection: close") || strstr(request, " HTTP/1.0\r\n"))
+            c->closing = true;
+
+        len = 0;
+        endpoint = ENDPOINT_COUNT - 1;
+        target = strchr(request, ' ');
+        if (!strncmp(request, "GET ", 4) && target && (slash = strchr(++target, ' ')) != NULL)
+        {
+            *slash = 0;
+            while (*target == '/')
+                target++;
+            query = strchr(target, '?');
+            if (query)
+                *query++ = 0;
+            else
+                query = "";
+            for (slash = target + strlen(target); slash > target && slash[-1] == '/';)
+                *--slash = 0;
+
+            // s/<token>[/path] stands for path (state if none) at the token's table, as its player
+            path = target;
+            session = NULL;
+            if (!strncmp(target, "s/", 2))
+            {
+                slash = strchr(target + 2, '/');
+                path = slash ? slash + 1 : "state";
+                if ((slash ? slash - target - 2 : (long)strlen(target + 2)) == API_TOKEN_SIZE)
+                    session = sessionOf(target + 2);
+            }
+
+            endpoint = endpointOf(path);
+            len = path == target || session ? handle(c, path, query, session, body) : 0;
+            if (len == HELD)
+                return;
+            if (verbose)
+                printf("%s?%s -> %u bytes\n", target, query, len);
+        }
+
+        stats.requests[endpoint]++;
+        stats.bytes[endpoint] += len;
+        if (!len)
+            stats.notFound++;
+
+        c->outLen += (uint32_t)snprintf((char *)c->out + c->outLen, 256,
+                                        "HTTP/1.1 %s\r\nContent-Type: application/octet-stream\r\nContent-Length: %u\r\n%s\r\n",
+                                        len ? "200 OK" : "404 Not Found", len, c->closing ? "Connection: close\r\n" : "");
+        memcpy(c->out + c->outLen, body, len);
+        c->outLen += len;
+
+        memmove(c->in, c->in + used, c->inLen - used);
+        c->inLen -= used;
+        c->waited = false;
+        if (c->closing)
+            break;
+    }
+}
+
+static void readConn(int epfd, Conn *c)
+{
+    ssize_t got = 0;
+
+    for (;;)
+    {
+        if (c->inLen < CONN_IN)
+        {
+            got = recv(c->fd, c->in + c->inLen, CONN_IN - c->inLen, 0);
+            if (got == 0 || (got < 0 && errno != EAGAIN))
+            {
+                closeConn(epfd, c);
+                return;
+            }
+            if (got > 0)
+                c->inLen += (uint16_t)got;
+        }
+
+        answerRequests(c);
+
+        if (c->outLen)
+        {
+            if (!flushConn(epfd, c))
+            {
+                closeConn(epfd, c);
+                return;
+            }
+
+            // Still sending, the rest waits for EPOLLOUT
+            if (c->outLen)
+                return;
+            continue;
+        }
+
+        // A request that fills the buffer without ending is not one we serve
+        if (c->inLen == CONN_IN)
+        {
+            closeConn(epfd, c);
+            return;
+        }
+
+        if (got < 0)
+            return;
+    }
+}
+
+/// @brief Answers the held calls whose table changed, or whose wait is over
+static void answerHeld(int epfd, uint64_t millis)
+{
+    size_t i = 0;
+    Conn *c;
+
+    while (i < heldCount)
+    {
+        c = held[i];
+        if (c->heldTable->seq == c->heldSeq && millis < c->heldUntil)
+        {
+            i++;
+            continue;
+        }
+        held[i] = held[--heldCount];
+        c->held = false;
+        c->waited = true;
+        readConn(epfd, c);
+    }
+}
+
+static void acceptConns(int epfd, int listenFd)
+{
+    struct epoll_event ev;
+    Conn *c;
+    int fd, one = 1;
+
+    while ((fd = accept4(listenFd, NULL, NULL, SOCK_NONBLOCK)) >= 0)
+    {
+        c = malloc(sizeof(Conn));
+        if (c == NULL)
+        {
+            close(fd);
+            continue;
+        }
+        memset(c, 0, offsetof(Conn, in));
+        c->fd = fd;
+        setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+        ev.events = EPOLLIN;
+        ev.data.ptr = c;
+        epoll_ctl(epfd, EPOLL_CTL_ADD, fd, &ev);
+        stats.connections++;
+    }
+}
+
+static void printStats(uint64_t elapsedMillis)
+{
+    uint32_t total = 0;
+    uint8_t i;
+
+    for (i = 0; i < ENDPOINT_COUNT; i++)
+        total += stats.requests[i];
+    if (!total)
+        return;
+
+    printf("%u connections, %u requests (%u not found), %.0f requests/s\n", stats.connections, total, stats.notFound,
+           elapsedMillis ? total * 1000.0 / elapsedMillis : 0.0);
+    printf("endpoint     requests    bytes  bytes/req\n");
+    for (i = 0; i < ENDPOINT_COUNT; i++)
+    {
+        if (stats.requests[i])
+            printf("%-10s %10u %8lu %10.1f\n", endpoints[i], stats.requests[i], (unsigned long)stats.bytes[i],
+                   (double)stats.bytes[i] / stats.requests[i]);
+    }
+    fflush(stdout);
+}
+
+static void onSignal(int sig)
+{
+    (void)sig;
+    stopping = 1;
+}
+
+static int listenOn(uint16_t port)
+{
+    struct sockaddr_in addr;
+    int fd, one = 1;
+
+    fd = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK, 0);
+    if (fd < 0)
+        return -1;
+
+    setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_ANY);
+    addr.sin_port = htons(port);
+    if (bind(fd, (struct sockaddr *)&addr, sizeof(addr)) || listen(fd, SOMAXCONN))
+    {
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+static void usage(const char *name)
+{
+    printf("usage: %s [--port 8080] [--bots 1] [--tables 3] [--seed 1] [--lockstep] [--stats 30] [--verbose]\n", name);
+    exit(2);
+}
+
+int main(int argc, char **argv)
+{
+    static struct epoll_event events[64];
+    struct epoll_event ev;
+    uint64_t start, lastStats, nextTick, millis;
+    int i, j, n, epfd, listenFd, port = 8080, bots = 1, count = 3, statsSeconds = 30, timeout;
+    size_t t;
+
+    for (i = 1; i < argc; i++)
+    {
+        if (!strcmp(argv[i], "--lockstep"))
+            lockstep = true;
+        else if (!strcmp(argv[i], "--verbose"))
+            verbose = true;
+        else if (i + 1 == argc)
+            usage(argv[0]);
+        else if (!strcmp(argv[i], "--port"))
+            port = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "--bots"))
+            bots = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "--tables"))
+            count = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "--seed"))
+            seed = (uint32_t)strtoul(argv[++i], NULL, 0);
+        else if (!strcmp(argv[i], "--stats"))
+            statsSeconds = atoi(argv[++i]);
+        else
+            usage(argv[0]);
+    }
+
+    // xorshift never leaves 0
+    if (!seed)
+        seed = 1;
+    if (bots > PLAYER_MAX)
+        bots = PLAYER_MAX;
+
+    if (count > 0 && count <= TABLE_MAX)
+        tableCount = count;
+    for (t = 3; t < tableCount; t++)
+    {
+        snprintf(tables[t].id, sizeof(tables[t].id), "t%u", (unsigned)(t + 1) % 1000);
+        snprintf(tables[t].name, sizeof(tables[t].name), "Table %u", (unsigned)(t + 1) % 1000);
+    }
+
+    for (t = 0; t < tableCount; t++)
+    {
+        resetTable(&tables[t]);
+        tables[t].seq = 1;
+        for (j = 0; j < bots; j++)
+        {
+            Player *bot = &tables[t].players[tables[t].playerCount++];
+
+            snprintf(bot->name, sizeof(bot->name), "bot%d", j + 1);
+            bot->bot = true;
+            resetPlayer(bot);
+        }
+    }
+
+    listenFd = listenOn((uint16_t)port);
+    epfd = epoll_create1(0);
+    if (listenFd < 0 || epfd < 0)
+    {
+        perror("fbs_server");
+        return 1;
+    }
+
+    ev.events = EPOLLIN;
+    ev.data.ptr = NULL;
+    epoll_ctl(epfd, EPOLL_CTL_ADD, listenFd, &ev);
+
+    signal(SIGINT, onSignal);
+    signal(SIGTERM, onSignal);
+    printf("Fuji Battleship stand-in listening on port %d%s\n", port, lockstep ? " (lockstep clock)" : "");
+    fflush(stdout);
+
+    start = lastStats = wallMillis();
+    nextTick = start + 1000 * TICK / JIFFIES;
+    while (!stopping)
+    {
+        millis = wallMillis();
+        timeout = lockstep ? 1000 : (int)(nextTick > millis ? nextTick - millis : 0);
+        n = epoll_wait(epfd, events, sizeof(events) / sizeof(events[0]), timeout);
+
+        // The wall clock drives the game unless in lockstep
+        millis = wallMillis();
+        if (!lockstep)
+            now = (uint32_t)((millis - start) * JIFFIES / 1000);
+
+        for (i = 0; i < n; i++)
+        {
+            Conn *c = events[i].data.ptr;
+
+            if (c == NULL)
+                acceptConns(epfd, listenFd);
+            else if (events[i].events & EPOLLOUT)
+            {
+                // Room again: send the rest, then carry on with requests already read
+                if (!flushConn(epfd, c))
+                    closeConn(epfd, c);
+                else if (!c->outLen)
+                    readConn(epfd, c);
+            }
+            else if (events[i].events & (EPOLLIN | EPOLLERR | EPOLLHUP))
+                readConn(epfd, c);
+        }
+
+        if (!lockstep && millis >= nextTick)
+        {
+            tickAll();
+            nextTick += 1000 * TICK / JIFFIES;
+            answerHeld(epfd, millis);
+        }
+
+        // Answering held calls can change tables again
+        while (tableChanged)
+        {
+            tableChanged = false;
+            answerHeld(epfd, millis);
+        }
+
+        if (statsSeconds && millis - lastStats >= (uint64_t)statsSeconds * 1000)
+        {
+            lastStats = millis;
+            printStats(millis - start);
+        }
+    }
+
+    printf("Exiting\n");
+    printStats(wallMillis() - start);
+    return 0;
+}
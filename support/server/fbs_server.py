@@ -0,0 +1,725 @@
+"""
+Local stand-in for the Fuji Battleship server.
+
+Implements the tables, state, ready, place/..., attack/N, leave and stats/... endpoints
+with the binary layouts of Tables, Lobby and Game in src/misc.h, so clients can
+be tested offline and the bytes sent per poll can be measured.
+
+  v=2  raw layouts, as sent by the public server
+  v=3  [type][capabilities][seq lo][seq hi] header, followed by either a full
+       snapshot (0xF0) or patch records (0xF1) against the client's last seq.
+       A state call with &wait=N is held until the table changes or N seconds pass
+  v=4  as v=3, with gamefields packed 2 bits per cell and only playerCount
+       players sent
+  v=5  as v=4, with a [poll hint lo][poll hint hi] header suffix: jiffies until
+       the server expects to change the table itself, 0 if a player may act first
+  v=6  as v=5. Calls made with table and player get a session token after the
+       header (capability 0x04). Later calls can use s/<token>[/path]?seq=N,
+       which implies the table, player and v=6
+
+Binary sessions (capability 0x08): a client with a token opens a tcp socket to
+--binary-port and sends [0x07][token][seq lo][seq hi]. Each request is then an
+opcode: 0x01 state, 0x02 state held until a change, 0x03 ready, 0x04 leave,
+0x05 [pos] attack, 0x06 [pos x5] place. Each response is a v6 response framed
+as [len lo][len hi][response].
+
+Push: clients subscribe to a table by sending their query string
+("?table=..&player=..") as a datagram to --push-port. Whenever the table
+changes, each subscriber gets [0xF2][seq lo][seq hi] back, so it only polls
+when something changed. Subscriptions lapse unless renewed.
+
+Usage:
+  python3 support/server/fbs_server.py [--port 8080] [--bots 1] [--seed 1]
+
+Point a client at it by setting the first byte of the e41c0500 appkey to 0xff
+(see localServer in src/main.c). Request counts and bytes per poll are printed
+every --stats seconds and when the server exits.
+"""
+
+import argparse
+import random
+import socket
+import struct
+import threading
+import time
+from http.server import BaseHTTPRequestHandler, ThreadingHTTPServer
+from urllib.parse import urlparse, parse_qs
+
+# Mirrors src/misc.h
+PLAYER_MAX = 4
+
+STATUS_LOBBY = 0
+STATUS_PLACE_SHIPS = 1
+STATUS_GAMESTART = 10
+STATUS_MISS = 11
+STATUS_HIT = 12
+STATUS_SUNK = 13
+STATUS_GAMEOVER = 99
+
+PLAYER_STATUS_DEFAULT = 0
+PLAYER_STATUS_DEFEATED = 1
+PLAYER_STATUS_VIEWING = 2
+PLAYER_STATUS_READY = 3
+PLAYER_STATUS_PLACE_SHIPS = 10
+
+FIELD_ATTACK = 1
+FIELD_MISS = 2
+
+SHIP_SIZES = [5, 4, 3, 3, 2]
+FIELD_PACKED_SIZE = 25
+
+# Mirrors src/stateclient.h
+API_RESP_FULL = 0xF0
+API_RESP_PATCH = 0xF1
+API_PATCH_MAX = 128  # Size of the client's tempBuffer
+SEQ_WRAP = 0x7FFF    # Client sends seq with itoa, so keep it positive
+API_CAP_LONGPOLL = 0x01
+API_CAP_PUSH = 0x02
+API_CAP_TOKEN = 0x04
+API_CAP_BINARY = 0x08
+BINARY_PORT = 6503
+OP_STATE, OP_WAIT, OP_READY, OP_LEAVE, OP_ATTACK, OP_PLACE, OP_HELLO = range(1, 8)
+TOKEN_CHARS = "abcdefghijklmnopqrstuvwxyz0123456789"
+TOKEN_SIZE = 4
+API_PUSH_CHANGED = 0xF2
+PUSH_PORT = 6502
+PUSH_EXPIRE = 30     # Seconds a push subscription lasts without being renewed
+LONGPOLL_MAX = 15    # Longest a state call is held, in seconds
+HISTORY = 16         # Payloads kept per player to build patches from
+
+JIFFIES = 60
+TICK_SECONDS = 0.25  # How often the ticker advances tables
+
+COUNTDOWN_SECONDS = 5
+MOVE_SECONDS = 20
+GAMEOVER_SECONDS = 15
+BOT_DELAY_SECONDS = 1.5
+
+TABLES = [("basement", "Basement Boat"), ("sea", "Open Sea"), ("dev", "Dev Table")]
+
+
+def cstr(text, size):
+    """Fixed size, zero padded and terminated string field"""
+    return text.encode("ascii", "replace")[: size - 1].ljust(size, b"\0")
+
+
+def ship_cells(pos, size):
+    """Cells covered by a ship at pos (add 100 for vertical), matching placeShip() in gamelogic.c"""
+    cells = []
+    for _ in range(size):
+        cells.append(pos % 100)
+        pos += 10 if pos >= 100 else 1
+    return cells
+
+
+def valid_placement(ships):
+    """Same rules as testShip() in gamelogic.c"""
+    if len(ships) != 5:
+        return False
+    used = set()
+    for size, pos in zip(SHIP_SIZES, ships):
+        for i in range(size):
+            if pos > 199 or (i > 0 and pos <= 100 and pos % 10 == 0) or pos % 100 in used:
+                return False
+            used.add(pos % 100)
+            pos += 10 if pos >= 100 else 1
+    return True
+
+
+def random_placement(rng):
+    while True:
+        ships = [rng.randrange(200) for _ in SHIP_SIZES]
+        if valid_placement(ships):
+            return ships
+
+
+def make_patch(old, new):
+    """Patch records [offset lo][offset hi][len][bytes] turning old into new.
+    Runs separated by fewer equal bytes than a record header are merged."""
+    patch = bytearray()
+    i, n = 0, len(new)
+    while i < n:
+        if i < len(old) and old[i] == new[i]:
+            i += 1
+            continue
+        start = end = i
+        while i < n and i - end <= 3 and i - start < 255:
+            if i >= len(old) or old[i] != new[i]:
+                end = i + 1
+            i += 1
+        patch += struct.pack("<HB", start, end - start) + new[start:end]
+        i = end
+    return bytes(patch)
+
+
+def pack_field(field):
+    """Packs a byte per cell gamefield into 2 bits per cell, first cell in the low bits"""
+    packed = bytearray(FIELD_PACKED_SIZE)
+    for i, cell in enumerate(field):
+        packed[i >> 2] |= (cell & 3) << ((i & 3) << 1)
+    return bytes(packed)
+
+
+class Player:
+    def __init__(self, name, bot=False):
+        self.name = name
+        self.bot = bot
+        self.ready = False
+        self.status = PLAYER_STATUS_DEFAULT
+        self.ships = []
+        self.field = bytearray(100)
+        self.ships_left = [1] * 5
+        self.history = {}  # seq -> payload last sent to this player
+        self.last_seen = time.time()
+
+    def reset(self):
+        self.ready = self.bot
+        self.status = PLAYER_STATUS_DEFAULT
+        self.ships = []
+        self.field = bytearray(100)
+        self.ships_left = [1] * 5
+
+
+class Table:
+    def __init__(self, table_id, name, rng, cond):
+        self.id = table_id
+        self.name = name
+        self.rng = rng
+        self.cond = cond
+        self.players = []
+        self.viewers = []
+        self.seq = 1
+        self.notify = None  # Called with the table on every change, when push is enabled
+        self.reset()
+
+    def reset(self):
+        self.status = STATUS_LOBBY
+        self.prompt = "waiting for players"
+        self.active = -1
+        self.last_attack = 0
+        self.winner = None
+        self.deadline = 0
+        self.countdown = 0
+        for p in self.players:
+            p.reset()
+
+    def changed(self):
+        self.seq = self.seq + 1 if self.seq < SEQ_WRAP else 1
+        self.cond.notify_all()
+        if self.notify:
+            self.notify(self)
+
+    def poll_hint(self, player, now):
+        """Jiffies until the next change the server makes on its own, or 0 if a player may act first"""
+        if self.status == STATUS_LOBBY:
+            if not self.deadline:
+                return 0
+            due = now + 1
+        elif self.status == STATUS_GAMEOVER:
+            due = self.deadline
+        elif self.status >= STATUS_GAMESTART:
+            active = self.players[self.active]
+            if active.bot:
+                due = min(self.deadline, self.deadline - MOVE_SECONDS + BOT_DELAY_SECONDS)
+            elif active is player:
+                due = self.deadline
+            else:
+                return 0
+        else:
+            return 0
+        return min(0xFFFF, max(0, int((due - now + TICK_SECONDS) * JIFFIES)) + 1)
+
+    def find(self, name):
+        for p in self.players + self.viewers:
+            if p.name == name:
+                return p
+        return None
+
+    def join(self, name):
+        player = self.find(name)
+        if player is None:
+            player = Player(name)
+            if self.status == STATUS_LOBBY and len(self.players) < PLAYER_MAX:
+                self.players.append(player)
+            else:
+                player.status = PLAYER_STATUS_VIEWING
+                self.viewers.append(player)
+            self.changed()
+        player.last_seen = time.time()
+        return player
+
+    def leave(self, player):
+        if player in self.viewers:
+            self.viewers.remove(player)
+        elif player in self.players:
+            if self.status == STATUS_LOBBY:
+                self.players.remove(player)
+            else:
+                player.status = PLAYER_STATUS_DEFEATED
+                self.check_winner()
+        self.changed()
+
+    # Game flow
+
+    def tick(self, now):
+        if self.status == STATUS_LOBBY:
+            ready = [p for p in self.players if p.ready]
+            if len(self.players) > 1 and len(ready) == len(self.players):
+                seconds = max(0, int(self.deadline - now + 0.999)) if self.deadline else COUNTDOWN_SECONDS
+                if not self.deadline:
+                    self.deadline = now + COUNTDOWN_SECONDS
+                if seconds == 0:
+                    self.start_placement()
+                elif seconds != self.countdown:
+                    self.countdown = seconds
+                    self.prompt = "starting in %d" % seconds
+                    self.changed()
+            elif self.deadline or self.prompt != "waiting for players":
+                self.deadline = self.countdown = 0
+                self.prompt = "waiting for players"
+                self.changed()
+        elif self.status == STATUS_PLACE_SHIPS:
+            for p in self.players:
+                if p.bot and not p.ships:
+                    self.place(p, random_placement(self.rng))
+        elif self.status == STATUS_GAMEOVER:
+            if now > self.deadline:
+                self.reset()
+                self.changed()
+        elif self.status >= STATUS_GAMESTART:
+            player = self.players[self.active]
+            if player.bot and now > self.deadline - MOVE_SECONDS + BOT_DELAY_SECONDS:
+                self.attack(player, self.bot_target())
+            elif now > self.deadline:
+                self.next_turn()
+                self.changed()
+
+    def start_placement(self):
+        self.status = STATUS_PLACE_SHIPS
+        self.prompt = "place your ships"
+        for p in self.players:
+            p.status = PLAYER_STATUS_PLACE_SHIPS
+        self.changed()
+
+    def place(self, player, ships):
+        if self.status != STATUS_PLACE_SHIPS or player not in self.players or not valid_placement(ships):
+            return
+        player.ships = ships
+        player.status = PLAYER_STATUS_DEFAULT
+        if all(p.ships for p in self.players):
+            self.status = STATUS_GAMESTART
+            self.active = self.rng.randrange(len(self.players))
+            self.deadline = time.time() + MOVE_SECONDS
+            self.prompt = ""
+        else:
+            self.prompt = "waiting on other players"
+        self.changed()
+
+    def alive(self):
+        return [p for p in self.players if p.status == PLAYER_STATUS_DEFAULT]
+
+    def bot_target(self):
+        open_cells = [pos for pos in range(100)
+                      if any(p.field[pos] == 0 for p in self.alive() if p is not self.players[self.active])]
+        return self.rng.choice(open_cells) if open_cells else 0
+
+    def attack(self, player, pos):
+        if self.status < STATUS_GAMESTART or self.status == STATUS_GAMEOVER:
+            return
+        if player is not self.players[self.active] or not 0 <= pos < 100:
+            return
+        hit = sunk = False
+        for target in self.alive():
+            if target is player or target.field[pos]:
+                continue
+            occupied = [ship_cells(s, size) for s, size in zip(target.ships, SHIP_SIZES)]
+            if any(pos in cells for cells in occupied):
+                target.field[pos] = FIELD_ATTACK
+                hit = True
+                for i, cells in enumerate(occupied):
+                    if target.ships_left[i] and all(target.field[c] == FIELD_ATTACK for c in cells):
+                        target.ships_left[i] = 0
+                        sunk = True
+                if not any(target.ships_left):
+                    target.status = PLAYER_STATUS_DEFEATED
+            else:
+                target.field[pos] = FIELD_MISS
+        self.last_attack = pos
+        self.status = STATUS_SUNK if sunk else STATUS_HIT if hit else STATUS_MISS
+        if not self.check_winner():
+            self.next_turn()
+        self.changed()
+
+    def next_turn(self):
+        for _ in range(len(self.players)):
+            self.active = (self.active + 1) % len(self.players)
+            if self.players[self.active].status == PLAYER_STATUS_DEFAULT:
+                break
+        self.deadline = time.time() + MOVE_SECONDS
+
+    def check_winner(self):
+        if self.status < STATUS_GAMESTART:
+            return False
+        alive = self.alive()
+        if len(alive) > 1:
+            return False
+        self.status = STATUS_GAMEOVER
+        self.winner = alive[0] if alive else None
+        self.active = self.players.index(self.winner) if self.winner else -1
+        self.prompt = ("%s won" % self.winner.name) if self.winner else "game over"
+        self.deadline = time.time() + GAMEOVER_SECONDS
+        return True
+
+    # Payloads
+
+    def view_order(self, player):
+        """Players ordered so that the requesting player is index 0"""
+        if player in self.players:
+            i = self.players.index(player)
+            return self.players[i:] + self.players[:i]
+        return list(self.players)
+
+    def lobby_payload(self, player):
+        order = self.view_order(player)
+        data = struct.pack("<B33sBBbB21s", len(order), cstr(self.prompt, 33), STATUS_LOBBY,
+                           PLAYER_STATUS_READY if player.ready else player.status, -1, 0,
+                           cstr(self.name, 21))
+        for i in range(PLAYER_MAX):
+            p = order[i] if i < len(order) else None
+            data += struct.pack("<9sB", cstr(p.name if p else "", 9), 1 if p and p.ready else 0)
+        return data
+
+    def game_payload(self, player, packed):
+        order = self.view_order(player)
+        active = order.index(self.players[self.active]) if self.active >= 0 else -1
+        my_ships = list(player.ships) if player.ships else [0] * 5
+        if self.status == STATUS_GAMEOVER and self.winner:
+            my_ships += self.winner.ships
+        my_ships = (my_ships + [0] * 10)[:10]
+        data = struct.pack("<B33sBBbBB10B", len(order), cstr(self.prompt, 33), self.status, player.status,
+                           active, MOVE_SECONDS, self.last_attack, *my_ships)
+        for i in range(len(order) if packed else PLAYER_MAX):
+            p = order[i] if i < len(order) else None
+            if p:
+                field = pack_field(p.field) if packed else bytes(p.field)
+                data += struct.pack("<9sB", cstr(p.name, 9), p.status) + field + bytes(p.ships_left)
+            else:
+                data += bytes(9 + 1 + 100 + 5)
+        return data
+
+    def payload(self, player, version):
+        if self.status == STATUS_LOBBY:
+            return self.lobby_payload(player)
+        return self.game_payload(player, version >= 4)
+
+
+class Server:
+    def __init__(self, seed, bots):
+        self.lock = threading.Lock()
+        self.cond = threading.Condition(self.lock)
+        self.rng = random.Random(seed)
+        self.tables = {tid: Table(tid, name, self.rng, self.cond) for tid, name in TABLES}
+        for table in self.tables.values():
+            for i in range(bots):
+                bot = Player("bot%d" % (i + 1), bot=True)
+                bot.ready = True
+                table.players.append(bot)
+        self.stats = {}
+        self.connections = 0
+        self.notifier = None
+        self.binary = False
+        self.sessions = {}  # token -> (table id, player name)
+        self.tokens = {}    # (table id, player name) -> token
+
+    def tick(self):
+        with self.lock:
+            now = time.time()
+            for table in self.tables.values():
+                table.tick(now)
+
+    def tables_payload(self):
+        tables = list(self.tables.values())
+        data = struct.pack("<B", len(tables))
+        for t in tables:
+            data += struct.pack("<9s21s6s", cstr(t.id, 9), cstr(t.name, 21),
+                                cstr("%d/%d" % (len(t.players), PLAYER_MAX), 6))
+        return data
+
+    def resolve(self, path, query):
+        """Turns a s/<token>[/path] call into the path and query it stands for, or None if the token is unknown"""
+        if not path.startswith("s/"):
+            return path, query
+        token, _, path = path[2:].partition("/")
+        with self.lock:
+            session = self.sessions.get(token)
+        if session is None:
+            return None, query
+        query = dict(query, table=[session[0]], player=[session[1]], v=["6"], bin=["1"], token=[token])
+        return path or "state", query
+
+    def token_for(self, table, name):
+        key = (table.id, name)
+        if key not in self.tokens:
+            while True:
+                token = "".join(self.rng.choice(TOKEN_CHARS) for _ in range(TOKEN_SIZE))
+                if token not in self.sessions:
+                    break
+            self.tokens[key] = token
+            self.sessions[token] = key
+        return self.tokens[key]
+
+    def handle(self, path, query):
+        version = int(query.get("v", ["2"])[0] or 2)
+        seq = int(query.get("seq", ["0"])[0] or 0)
+        wait = min(int(query.get("wait", ["0"])[0] or 0), LONGPOLL_MAX)
+
+        with self.lock:
+            if path == "tables":
+                return self.encode(None, None, self.tables_payload(), version, seq)
+
+            table = self.tables.get(query.get("table", [""])[0])
+            name = query.get("player", [""])[0][:8].lower()
+            if table is None or not name:
+                return b""
+
+            # Long-poll: hold the call until the table moves past the client's seq
+            if path == "state" and wait and seq == table.seq and table.find(name):
+                table.cond.wait_for(lambda: table.seq != seq, timeout=wait)
+
+            player = table.join(name)
+            if path == "ready" and table.status == STATUS_LOBBY and player in table.players:
+                player.ready = not player.ready
+                table.changed()
+            elif path.startswith("place/"):
+                try:
+                    table.place(player, [int(p) for p in path[6:].split(",")])
+                except ValueError:
+                    pass
+            elif path.startswith("attack/"):
+                try:
+                    table.attack(player, int(path[7:]))
+                except ValueError:
+                    pass
+            elif path == "leave":
+                table.leave(player)
+            elif path.startswith("stats/"):
+                # Network stats a client in debug mode sends at the end of a game (queueStatsUpload in src/stateclient.c)
+                print(f"client stats from {name}: {path[6:]}")
+
+            table.tick(time.time())
+
+            # Issue a session token to clients that named the table and player
+            token = None
+            if version >= 6 and "token" not in query:
+                token = self.token_for(table, name)
+            return self.encode(table, player, table.payload(player, version), version, seq, token)
+
+    def encode(self, table, player, payload, version, seq, token=None):
+        if version < 3:
+            return payload
+
+        caps = API_CAP_LONGPOLL | (API_CAP_PUSH if self.notifier else 0) | (API_CAP_BINARY if self.binary else 0)
+        hint = struct.pack("<H", table.poll_hint(player, time.time()) if table else 0) if version >= 5 else b""
+        if token:
+            caps |= API_CAP_TOKEN
+            hint += token.encode("ascii")
+        if table is None:
+            return struct.pack("<BBH", API_RESP_FULL, caps, 0) + hint + payload
+
+        current = table.seq
+        player.history[current] = payload
+        for old in sorted(player.history)[:-HISTORY]:
+            del player.history[old]
+
+        # Patch against the payload the client last applied, if still known
+        base = player.history.get(seq) if seq else None
+        if base is not None and len(base) == len(payload):
+            patch = make_patch(base, payload)
+            if len(patch) <= API_PATCH_MAX:
+                return struct.pack("<BBH", API_RESP_PATCH, caps, current) + hint + patch
+
+        return struct.pack("<BBH", API_RESP_FULL, caps, current) + hint + payload
+
+    def record(self, path, version, size, url_size):
+        endpoint = "state" if path in ("state", "") else path.split("/")[0]
+        key = (endpoint, version)
+        count, total, url_total = self.stats.get(key, (0, 0, 0))
+        self.stats[key] = (count + 1, total + size, url_total + url_size)
+
+    def print_stats(self):
+        with self.lock:
+            if not self.stats:
+                return
+            requests = sum(stat[0] for stat in self.stats.values())
+            print(f"{self.connections} connections, {requests / max(self.connections, 1):.1f} requests per connection")
+            if self.notifier:
+                print(f"{self.notifier.sent} push notifications sent")
+            print("endpoint     v   requests    bytes  bytes/req  url/req")
+            for (endpoint, version), (count, total, url_total) in sorted(self.stats.items()):
+                print(f"{endpoint:<10} {version:>3} {count:>10} {total:>8} {total / count:>10.1f} {url_total / count:>8.1f}")
+
+
+class Notifier:
+    """Stand-in push notifier: tells subscribed clients when their table changes"""
+
+    def __init__(self, server, port):
+        self.server = server
+        self.sock = socket.socket(socket.AF_INET, socket.SOCK_DGRAM)
+        self.sock.bind(("", port))
+        self.subscribers = {}  # table id -> {address: time subscribed}
+        self.sent = 0
+        for table in server.tables.values():
+            table.notify = self.notify
+        server.notifier = self
+
+    def run(self):
+        while True:
+            data, address = self.sock.recvfrom(256)
+            query = parse_qs(urlparse(data.decode("ascii", "replace")).query)
+            table_id = query.get("table", [""])[0]
+            with self.server.lock:
+                if table_id in self.server.tables:
+                    for subs in self.subscribers.values():
+                        subs.pop(address, None)
+                    self.subscribers.setdefault(table_id, {})[address] = time.time()
+
+    def notify(self, table):
+        # Called with the server lock held
+        subs = self.subscribers.get(table.id, {})
+        now = time.time()
+        datagram = struct.pack("<BH", API_PUSH_CHANGED, table.seq)
+        for address, since in list(subs.items()):
+            if now - since > PUSH_EXPIRE:
+                del subs[address]
+                continue
+            self.sock.sendto(datagram, address)
+            self.sent += 1
+
+
+def read_exact(sock, size):
+    data = b""
+    while len(data) < size:
+        chunk = sock.recv(size - len(data))
+        if not chunk:
+            raise ConnectionError
+        data += chunk
+    return data
+
+
+def binary_session(server, sock):
+    """Serves one binary session: a hello, then an opcode per request and a framed response each"""
+    with sock:
+        try:
+            hello = read_exact(sock, 1 + TOKEN_SIZE + 2)
+            if hello[0] != OP_HELLO:
+                return
+            token = hello[1:1 + TOKEN_SIZE].decode("ascii", "replace")
+            seq = struct.unpack("<H", hello[1 + TOKEN_SIZE:])[0]
+            with server.lock:
+                server.connections += 1
+
+            while True:
+                op = read_exact(sock, 1)[0]
+                query = {"seq": [str(seq)]}
+                size = 1
+                if op == OP_ATTACK:
+                    path = "attack/%d" % read_exact(sock, 1)[0]
+                    size += 1
+                elif op == OP_PLACE:
+                    path = "place/" + ",".join(str(b) for b in read_exact(sock, 5))
+                    size += 5
+                else:
+                    path = {OP_STATE: "state", OP_WAIT: "state", OP_READY: "ready", OP_LEAVE: "leave"}.get(op)
+                    if path is None:
+                        return
+                    if op == OP_WAIT:
+                        query["wait"] = [str(LONGPOLL_MAX)]
+
+                path, query = server.resolve("s/%s/%s" % (token, path), query)
+                body = server.handle(path, query) if path is not None else b""
+                server.record(path or "", 6, len(body), size)
+                if len(body) >= 4:
+                    seq = struct.unpack("<H", body[2:4])[0]
+                sock.sendall(struct.pack("<H", len(body)) + body)
+                if not body:
+                    return
+        except (ConnectionError, OSError):
+            pass
+
+
+def binary_listener(server, port):
+    listener = socket.socket(socket.AF_INET, socket.SOCK_STREAM)
+    listener.setsockopt(socket.SOL_SOCKET, socket.SO_REUSEADDR, 1)
+    listener.bind(("", port))
+    listener.listen()
+    while True:
+        sock, _ = listener.accept()
+        threading.Thread(target=binary_session, args=(server, sock), daemon=True).start()
+
+
+def make_handler(server):
+    class Handler(BaseHTTPRequestHandler):
+        # Keep connections open, for clients using the session channel
+        protocol_version = "HTTP/1.1"
+
+        def setup(self):
+            super().setup()
+            with server.lock:
+                server.connections += 1
+
+        def do_GET(self):
+            url = urlparse(self.path)
+            path, query = server.resolve(url.path.strip("/"), parse_qs(url.query))
+            body = server.handle(path, query) if path is not None else b""
+            server.record(path or "", int(query.get("v", ["2"])[0] or 2), len(body), len(self.path))
+
+            self.send_response(200 if body else 404)
+            self.send_header("Content-Type", "application/octet-stream")
+            self.send_header("Content-Length", str(len(body)))
+            self.end_headers()
+            self.wfile.write(body)
+
+        def log_message(self, format, *args):
+            if server_args.verbose:
+                super().log_message(format, *args)
+
+    return Handler
+
+
+def ticker(server, stats_interval):
+    last_stats = time.time()
+    while True:
+        time.sleep(TICK_SECONDS)
+        server.tick()
+        if stats_interval and time.time() - last_stats > stats_interval:
+            last_stats = time.time()
+            server.print_stats()
+
+
+if __name__ == "__main__":
+    parser = argparse.ArgumentParser(description="Local Fuji Battleship server stand-in")
+    parser.add_argument("--port", type=int, default=8080)
+    parser.add_argument("--bots", type=int, default=1, help="bot players seated at every table")
+    parser.add_argument("--seed", type=int, default=1, help="seed for turn order and bot moves")
+    parser.add_argument("--stats", type=int, default=30, help="seconds between stats reports, 0 to disable")
+    parser.add_argument("--push-port", type=int, default=PUSH_PORT, help="udp port for push notifications, 0 to disable")
+    parser.add_argument("--binary-port", type=int, default=BINARY_PORT, help="tcp port for binary sessions, 0 to disable")
+    parser.add_argument("--verbose", action="store_true", help="log every request")
+    server_args = parser.parse_args()
+
+    game_server = Server(server_args.seed, server_args.bots)
+    threading.Thread(target=ticker, args=(game_server, server_args.stats), daemon=True).start()
+    if server_args.binary_port:
+        game_server.binary = True
+        threading.Thread(target=binary_listener, args=(game_server, server_args.binary_port), daemon=True).start()
+    if server_args.push_port:
+        notifier = Notifier(game_server, server_args.push_port)
+        threading.Thread(target=notifier.run, daemon=True).start()
+
+    httpd = ThreadingHTTPServer(("", server_args.port), make_handler(game_server))
+    print(f"Fuji Battleship stand-in listening on port {server_args.port}")
+    try:
+        httpd.serve_forever()
+    except KeyboardInterrupt:
+        print("Exiting")
+    game_server.print_stats()
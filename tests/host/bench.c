@@ -0,0 +1,171 @@
+/*
+  Host benchmarks - the work done per state change, at native speed.
+  Build and run with: make host/bench
+
+  ns/op is native cpu time, which tracks the instruction count the 8-bit targets pay for the same work.
+  frames/op is the jiffies spent in pause() and friends, or playing out the animation timeline, which cost the same on every platform.
+  cells/op is the text and icon cells the shadow screen pushed to the platform, what a slow-blit platform pays per cell.
+*/
+
+#include <stdio.h>
+#include <time.h>
+#include "fixtures.h"
+
+#define DEFAULT_ITERATIONS 20000
+
+static uint32_t iterations = DEFAULT_ITERATIONS;
+static Game gameA, gameB;
+static Lobby lobby;
+
+static uint64_t now()
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+static void report(const char *name, uint64_t start, uint32_t frames, uint32_t cells)
+{
+    uint64_t ns = now() - start;
+
+    printf("%-28s %8lu %10.1f %10.1f %10.1f\n", name, (unsigned long)iterations,
+           (double)ns / iterations, (double)frames / iterations, (double)cells / iterations);
+}
+
+/// @brief Runs op iterations times from a fresh fixture, with setup before each iteration
+static void bench(const char *name, void (*setup)(), void (*op)())
+{
+    static uint64_t start;
+    static uint32_t i, frames, cells;
+
+    fixtureReset();
+    frames = cells = 0;
+    start = now();
+    for (i = 0; i < iterations; i++)
+    {
+        if (setup)
+            setup();
+        flushScreen();
+        hostStats.frames = 0;
+        hostStats.chars = 0;
+        op();
+        flushScreen();
+        frames += hostStats.frames;
+        cells += hostStats.chars;
+    }
+    report(name, start, frames, cells);
+}
+
+static void queueA()
+{
+    queueGame(&gameA, 1);
+}
+
+static void queueAlternating()
+{
+    static uint16_t seq;
+
+    seq++;
+    queueGame(seq & 1 ? &gameA : &gameB, seq);
+}
+
+static void queueSmallPatch()
+{
+    static uint8_t patch[] = {0, 0, 1, 0};
+
+    patch[0] = offsetof(Game, activePlayer);
+    patch[3] = (patch[3] + 1) & 3;
+    queuePatch(patch, sizeof(patch), 2);
+}
+
+static void opApiCall()
+{
+    apiCall("state");
+}
+
+static void opBackgroundPoll()
+{
+    while (getStateFromServer() == STATE_UPDATE_PENDING)
+        ;
+}
+
+static void setupLobby()
+{
+    lobby.prompt[0] = 'a' + (lobby.prompt[0] + 1) % 26;
+    memcpy(&clientState.lobby, &lobby, sizeof(Lobby));
+}
+
+static void setupRedraw()
+{
+    memcpy(&clientState.game, &gameA, sizeof(Game));
+    state.drawBoard = true;
+}
+
+static void setupAttack()
+{
+    static uint8_t n;
+
+    // Alternate between the two states so every change animates a hit
+    memcpy(&clientState.game, ++n & 1 ? &gameB : &gameA, sizeof(Game));
+    state.prevActivePlayer = clientState.game.activePlayer == 1 ? 2 : 1;
+    memset(state.gamefield, 0, sizeof(state.gamefield));
+}
+
+static void opProcessStateChange()
+{
+    processStateChange();
+}
+
+/// @brief The change and the gamefields a full redraw leaves for the frames after
+static void opFullRedraw()
+{
+    processStateChange();
+    redrawFinish();
+}
+
+/// @brief The change and every frame of the animations it starts
+static void opAnimatedStateChange()
+{
+    processStateChange();
+    timelineWait();
+}
+
+static void opTestShipAll()
+{
+    static uint8_t pos;
+
+    pos = 0;
+    do
+        testShip(5, pos);
+    while (++pos < 200);
+}
+
+int main(int argc, char **argv)
+{
+    if (argc > 1)
+        iterations = atoi(argv[1]);
+
+    makeLobby(&lobby, 4, 2);
+    makeGame(&gameA, 4, STATUS_HIT, 1);
+    gameA.lastAttackPos = 44;
+    setCell(gameA.players[0].gamefield, 44, FIELD_ATTACK);
+    makeGame(&gameB, 4, STATUS_HIT, 2);
+    gameB.lastAttackPos = 45;
+    setCell(gameB.players[3].gamefield, 45, FIELD_MISS);
+    gameB.players[3].shipsLeft[2] = 0;
+
+    printf("%-28s %8s %10s %10s %10s\n", "benchmark", "iters", "ns/op", "frames/op", "cells/op");
+
+    bench("apiCall full snapshot", queueA, opApiCall);
+    bench("apiCall patch", queueSmallPatch, opApiCall);
+    bench("background poll, changed", queueAlternating, opBackgroundPoll);
+    bench("background poll, same", queueA, opBackgroundPoll);
+    bench("lobby update", setupLobby, opProcessStateChange);
+    bench("full board redraw", setupRedraw, opFullRedraw);
+    bench("full board redraw, 1st frame", setupRedraw, opProcessStateChange);
+    bench("attack state change", setupAttack, opAnimatedStateChange);
+    bench("testShip, every position", NULL, opTestShipAll);
+
+    return 0;
+}
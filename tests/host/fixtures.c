@@ -0,0 +1,114 @@
+/*
+  Canned server payloads and game setups shared by the host tests and benchmarks
+*/
+
+#include "fixtures.h"
+
+static const char *names[PLAYER_MAX] = {"ann", "bob", "cy", "dee"};
+
+void fixtureReset()
+{
+    hostReset();
+    clearCommonInput();
+    resetTasks();
+    memset(&clientState, 0, sizeof(clientState));
+    memset(&state, 0, sizeof(state));
+    memset(&apiStats, 0, sizeof(apiStats));
+    memset(shipPlacements, 0, sizeof(shipPlacements));
+    shipPlaceIndex = posX = posY = 0;
+
+    strcpy(serverEndpoint, "https://host.test/");
+    strcpy(query, "?table=t1&player=ann");
+    strcpy(playerName, "ann");
+
+    state.prevStatus = STATE_INVALID;
+    state.drawBoard = true;
+    resetApiSession();
+}
+
+void queueFull(const void *payload, uint16_t len, uint16_t seq, uint8_t caps, uint16_t hint)
+{
+    static uint8_t buf[API_HEADER_SIZE + API_TOKEN_SIZE + sizeof(ClientState)];
+    uint8_t *p = buf;
+
+    *p++ = API_RESP_FULL;
+    *p++ = caps;
+    *p++ = seq & 0xFF;
+    *p++ = seq >> 8;
+    *p++ = hint & 0xFF;
+    *p++ = hint >> 8;
+    if (caps & API_CAP_TOKEN)
+    {
+        memcpy(p, "tk01", API_TOKEN_SIZE);
+        p += API_TOKEN_SIZE;
+    }
+    memcpy(p, payload, len);
+
+    hostQueueResponse(buf, (uint16_t)(p - buf) + len);
+}
+
+void queuePatch(const uint8_t *records, uint16_t len, uint16_t seq)
+{
+    static uint8_t buf[API_HEADER_SIZE + sizeof(tempBuffer)];
+
+    buf[0] = API_RESP_PATCH;
+    buf[1] = 0;
+    buf[2] = seq & 0xFF;
+    buf[3] = seq >> 8;
+    buf[4] = buf[5] = 0;
+    memcpy(buf + API_HEADER_SIZE, records, len);
+
+    hostQueueResponse(buf, API_HEADER_SIZE + len);
+}
+
+void queueGame(const Game *game, uint16_t seq)
+{
+    queueFull(game, sizeof(Game), seq, 0, 0);
+}
+
+void makeLobby(Lobby *lobby, uint8_t count, uint8_t ready)
+{
+    uint8_t i;
+
+    memset(lobby, 0, sizeof(Lobby));
+    lobby->playerCount = count;
+    lobby->status = STATUS_LOBBY;
+    lobby->moveTime = 30;
+    strcpy(lobby->prompt, "waiting for players");
+    strcpy(lobby->serverName, "host test table");
+    for (i = 0; i < count; i++)
+    {
+        strcpy(lobby->players[i].name, names[i]);
+        lobby->players[i].ready = i < ready;
+    }
+}
+
+void makeGame(Game *game, uint8_t count, uint8_t status, int8_t activePlayer)
+{
+    static const uint8_t ships[10] = {0, 20, 40, 60, 80, 5, 25, 45, 65, 85};
+    uint8_t i;
+
+    memset(game, 0, sizeof(Game));
+    game->playerCount = count;
+    game->status = status;
+    game->activePlayer = activePlayer;
+    game->moveTime = 20;
+    game->lastAttackPos = 0;
+    strcpy(game->prompt, "attack!");
+    memcpy(game->myShips, ships, sizeof(ships));
+    for (i = 0; i < count; i++)
+    {
+        strcpy(game->players[i].name, names[i]);
+        memset(game->players[i].shipsLeft, 1, 5);
+    }
+}
+
+void setCell(uint8_t *field, uint8_t pos, uint8_t value)
+{
+    field[pos >> 2] = (field[pos >> 2] & ~(3 << ((pos & 3) << 1))) | (value << ((pos & 3) << 1));
+}
+
+const char *lastRequest()
+{
+    return hostLastUrl + 2 + strlen(serverEndpoint);
+}
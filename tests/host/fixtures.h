@@ -0,0 +1,43 @@
+/*
+  Canned server payloads and game setups shared by the host tests and benchmarks
+*/
+#ifndef FIXTURES_H
+#define FIXTURES_H
+
+#include "../../src/misc.h"
+#include "../../src/stateclient.h"
+#include "../../src/gamelogic.h"
+#include "../../src/screens.h"
+#include "../../src/timeline.h"
+#include "../../src/task.h"
+#include "../../src/host/host.h"
+
+// Globals of gamelogic.c the flows inspect
+extern uint8_t posX, posY, shipPlaceIndex;
+extern uint8_t shipPlacements[5];
+
+/// @brief Fresh host, client state and api session, joined to table "t1" as player "ann" unless query is cleared after
+void fixtureReset();
+
+/// @brief Queues a v6 full snapshot of the first len bytes of payload
+void queueFull(const void *payload, uint16_t len, uint16_t seq, uint8_t caps, uint16_t hint);
+
+/// @brief Queues a v6 patch: each record is [offset lo][offset hi][len][len bytes], records is the raw list
+void queuePatch(const uint8_t *records, uint16_t len, uint16_t seq);
+
+/// @brief Queues a full snapshot of game
+void queueGame(const Game *game, uint16_t seq);
+
+/// @brief Fills in a lobby with count players, the first ready ones marked
+void makeLobby(Lobby *lobby, uint8_t count, uint8_t ready);
+
+/// @brief Fills in a game in progress with count players, all with intact fleets and clear fields
+void makeGame(Game *game, uint8_t count, uint8_t status, int8_t activePlayer);
+
+/// @brief Sets cell pos of a packed gamefield
+void setCell(uint8_t *field, uint8_t pos, uint8_t value);
+
+/// @brief Returns the request (path and query) of the last url opened, without the server endpoint
+const char *lastRequest();
+
+#endif /* FIXTURES_H */
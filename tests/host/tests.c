@@ -0,0 +1,1227 @@
+/*
+  Host test suite - drives the game logic and state client against canned server payloads.
+  Build and run with: make host
+*/
+
+#include <stdio.h>
+#include "fixtures.h"
+
+#define CHECK(cond) check((cond), #cond, __LINE__)
+
+// More than any flow below needs, so a flow stuck waiting on input fails fast
+#define TEST_FRAME_LIMIT 20000
+
+static const char *currentTest;
+static uint16_t checks, failed;
+static bool testFailed;
+static jmp_buf escape;
+
+static void check(bool ok, const char *expr, int line)
+{
+    checks++;
+    if (ok)
+        return;
+
+    if (!testFailed)
+        failed++;
+    testFailed = true;
+    printf("  FAIL %s (line %d): %s\n", currentTest, line, expr);
+}
+
+/// @brief Runs the tasks of main(), until every queued response was served or maxFrames pass
+static void runLoop(uint16_t maxFrames)
+{
+    while (maxFrames-- && (hostPendingResponses() || apiBusy()))
+        runTasks();
+}
+
+/// @brief Runs the input task alone until a flow finishes, for the flows that need no server
+static void runFlow(uint8_t (*task)(), uint16_t maxFrames)
+{
+    do
+    {
+        waitvsync();
+        readCommonInput();
+    } while (task() == TASK_RUNNING && --maxFrames);
+}
+
+/// @brief Runs the render and input tasks for frames frames, with no polls
+static void runFrames(uint16_t frames)
+{
+    while (frames--)
+    {
+        waitvsync();
+        renderTask();
+        processInput();
+    }
+}
+
+/// @brief Plays the animation timeline and the rest of the redraw job out a frame at a time, with nothing else running
+static void runTimeline(uint16_t maxFrames)
+{
+    while ((timelineBusy() || redrawBusy()) && maxFrames--)
+    {
+        waitvsync();
+        renderTask();
+    }
+}
+
+/// @brief Runs the loop with the next poll due right away, as after a push notification. Input is not read
+/// while a response comes in, so scripted input is left for the state it was meant for.
+static void pollNow(uint16_t maxFrames)
+{
+    state.apiCallWait = 0;
+    runLoop(maxFrames);
+}
+
+static bool requestIs(const char *path)
+{
+    return strncmp(lastRequest(), path, strlen(path)) == 0;
+}
+
+static const uint8_t pressTrigger[] = {0x10, 0, 0x10, 0};
+
+/*****************************************************************
+ * Ship placement
+ *****************************************************************/
+
+static void testShipBounds()
+{
+    memset(tempBuffer, 0, sizeof(tempBuffer));
+
+    CHECK(testShip(5, 0));
+    CHECK(testShip(5, 5));
+    CHECK(!testShip(5, 6));     // Runs off the right edge
+    CHECK(testShip(5, 150));    // Vertical, ends on the bottom row
+    CHECK(!testShip(5, 160));   // Vertical, runs off the bottom
+
+    placeShip(5, 0);
+    CHECK(!testShip(2, 3));     // Overlaps horizontally
+    CHECK(!testShip(2, 103));   // Overlaps vertically
+    CHECK(testShip(2, 10));
+}
+
+static void testShipPlacement()
+{
+    static uint8_t script[1 + 5 * 3];
+    Game game;
+    uint8_t i;
+
+    // The frame that starts placing reads its input before the flow clears it, then a press per ship
+    for (i = 1; i < sizeof(script); i += 3)
+        memcpy(script + i, pressTrigger, 3);
+
+    makeGame(&game, 2, STATUS_PLACE_SHIPS, -1);
+    game.playerStatus = PLAYER_STATUS_PLACE_SHIPS;
+    queueGame(&game, 1);
+    CHECK(apiCall("state") == API_CALL_SUCCESS);
+
+    hostJoystickScript(script, sizeof(script), false);
+    processStateChange();
+    runFlow(shipPlacementTask, 1000);
+    CHECK(shipPlaceIndex == 5);
+    CHECK(strcmp(hostLastSound, "select") == 0);
+
+    // The placements must not overlap
+    memset(tempBuffer, 0, sizeof(tempBuffer));
+    for (i = 0; i < 5; i++)
+    {
+        CHECK(testShip(shipSize[i], shipPlacements[i]));
+        placeShip(shipSize[i], shipPlacements[i]);
+    }
+
+    queueGame(&game, 2);
+    flushCommands();
+    CHECK(requestIs("place/"));
+}
+
+/*****************************************************************
+ * State client
+ *****************************************************************/
+
+static void testFullSnapshot()
+{
+    Game game;
+
+    makeGame(&game, 3, STATUS_GAMESTART, 1);
+    queueGame(&game, 7);
+    CHECK(apiCall("state") == API_CALL_SUCCESS);
+    CHECK(strcmp(lastRequest(), "state?table=t1&player=ann&bin=1&v=" API_CLIENT_VERSION "&seq=0") == 0);
+    CHECK(memcmp(&clientState.game, &game, sizeof(Game)) == 0);
+
+    // The next call asks for changes since the applied seq
+    queueGame(&game, 7);
+    apiCall("state");
+    CHECK(requestIs("state?table=t1&player=ann&bin=1&v=" API_CLIENT_VERSION "&seq=7"));
+}
+
+static void testPatch()
+{
+    Game game;
+    uint8_t patch[] = {0, 0, 2, STATUS_HIT, 1};
+
+    makeGame(&game, 2, STATUS_GAMESTART, 0);
+    queueGame(&game, 5);
+    apiCall("state");
+
+    patch[0] = offsetof(Game, status);
+    patch[4] = 1; // playerStatus follows status
+    queuePatch(patch, sizeof(patch), 6);
+    CHECK(apiCall("state") == API_CALL_SUCCESS);
+    CHECK(clientState.game.status == STATUS_HIT);
+    CHECK(clientState.game.playerStatus == 1);
+    CHECK(clientState.game.activePlayer == 0);
+
+    // A record past the end of clientState is rejected
+    patch[0] = 0xFF;
+    patch[1] = 0xFF;
+    queuePatch(patch, sizeof(patch), 7);
+    CHECK(apiCall("state") == API_CALL_ERROR);
+}
+
+static void testErrors()
+{
+    uint8_t headerOnly[API_HEADER_SIZE] = {API_RESP_FULL};
+    Game game;
+
+    makeGame(&game, 2, STATUS_GAMESTART, 0);
+    queueGame(&game, 1);
+    apiCall("state");
+
+    hostQueueError();
+    CHECK(apiCall("state") == API_CALL_ERROR);
+    CHECK(clientState.firstByte == 0);
+
+    hostQueueResponse(headerOnly, sizeof(headerOnly));
+    CHECK(apiCall("state") == API_CALL_ERROR);
+
+    // After an error the client starts over with a full snapshot
+    queueGame(&game, 3);
+    apiCall("state");
+    CHECK(requestIs("state?table=t1&player=ann&bin=1&v=" API_CLIENT_VERSION "&seq=0"));
+}
+
+static void testSessionToken()
+{
+    Game game;
+
+    makeGame(&game, 2, STATUS_GAMESTART, 0);
+    queueFull(&game, sizeof(Game), 4, API_CAP_TOKEN, 0);
+    CHECK(apiCall("state") == API_CALL_SUCCESS);
+    CHECK(memcmp(&clientState.game, &game, sizeof(Game)) == 0);
+
+    queueGame(&game, 4);
+    apiCall("state");
+    CHECK(strcmp(lastRequest(), "s/tk01?seq=4") == 0);
+
+    queueGame(&game, 5);
+    apiCall("attack/42");
+    CHECK(strcmp(lastRequest(), "s/tk01/attack/42?seq=4") == 0);
+}
+
+static void testLegacyPayload()
+{
+    static uint8_t legacy[sizeof(Game) - sizeof(clientState.game.players) + PLAYER_MAX * 115];
+    Game game;
+    uint8_t *p, i;
+
+    makeGame(&game, 2, STATUS_MISS, 1);
+    p = legacy + (sizeof(Game) - sizeof(game.players));
+    memcpy(legacy, &game, p - legacy);
+    for (i = 0; i < PLAYER_MAX; i++)
+    {
+        memcpy(p, &game.players[i], 10);
+        memset(p + 10, 0, FIELD_CELLS);
+        memcpy(p + 10 + FIELD_CELLS, game.players[i].shipsLeft, 5);
+        p += 115;
+    }
+    legacy[(p - legacy) - 3 * 115 + 10 + 42] = FIELD_ATTACK; // Player 1, cell 42
+    legacy[(p - legacy) - 3 * 115 + 10 + 99] = FIELD_MISS;
+
+    hostQueueResponse(legacy, sizeof(legacy));
+    CHECK(apiCall("state") == API_CALL_SUCCESS);
+    CHECK(clientState.game.status == STATUS_MISS);
+    CHECK(FIELD_CELL(clientState.game.players[1].gamefield, 42) == FIELD_ATTACK);
+    CHECK(FIELD_CELL(clientState.game.players[1].gamefield, 99) == FIELD_MISS);
+    CHECK(FIELD_CELL(clientState.game.players[1].gamefield, 43) == 0);
+    CHECK(clientState.game.players[1].shipsLeft[4] == 1);
+}
+
+static void testVersionNegotiation()
+{
+    Lobby lobby;
+
+    // A server answering the first call with a raw layout gets v2 calls from then on
+    makeLobby(&lobby, 2, 0);
+    hostQueueResponse((const uint8_t *)&lobby, sizeof(lobby));
+    CHECK(apiCall("state") == API_CALL_SUCCESS);
+    CHECK(requestIs("state?table=t1&player=ann&bin=1&v=" API_CLIENT_VERSION "&seq=0"));
+    hostQueueResponse((const uint8_t *)&lobby, sizeof(lobby));
+    apiCall("state");
+    CHECK(requestIs("state?table=t1&player=ann&bin=1&v=2&seq=0"));
+
+    // As does one that fails it, until the next table
+    resetApiSession();
+    hostQueueError();
+    CHECK(apiCall("state") == API_CALL_ERROR);
+    CHECK(requestIs("state?table=t1&player=ann&bin=1&v=" API_CLIENT_VERSION "&seq=0"));
+    queueFull(&lobby, sizeof(lobby), 1, 0, 0);
+    CHECK(apiCall("state") == API_CALL_SUCCESS);
+    CHECK(requestIs("state?table=t1&player=ann&bin=1&v=2&seq=0"));
+
+    // A v3+ header shows the server knows later versions
+    queueFull(&lobby, sizeof(lobby), 2, 0, 0);
+    apiCall("state");
+    CHECK(requestIs("state?table=t1&player=ann&bin=1&v=" API_CLIENT_VERSION "&seq=1"));
+}
+
+/// @brief Runs a background poll to the end, a step per frame, counting the frames it took
+static uint8_t pollInBackground(uint16_t *frames)
+{
+    static uint8_t result;
+
+    *frames = 0;
+    while ((result = getStateFromServer()) == STATE_UPDATE_PENDING)
+    {
+        ++*frames;
+        waitvsync();
+    }
+
+    return result;
+}
+
+static void testBackgroundPoll()
+{
+    Game game;
+    uint16_t frames;
+
+    // A slow link delivers a few bytes per frame, so the response takes many frames to come in
+    hostSetChunk(16);
+    makeGame(&game, 4, STATUS_GAMESTART, 2);
+    queueGame(&game, 1);
+    CHECK(pollInBackground(&frames) == STATE_UPDATE_CHANGE);
+    CHECK(frames > 10);
+
+    // The same state again is no change
+    queueGame(&game, 1);
+    CHECK(pollInBackground(&frames) == STATE_UPDATE_NOCHANGE);
+
+    game.activePlayer = 3;
+    queueGame(&game, 2);
+    CHECK(pollInBackground(&frames) == STATE_UPDATE_CHANGE);
+}
+
+static void testCutShortRead()
+{
+    Game game;
+
+    makeGame(&game, 2, STATUS_GAMESTART, 1);
+    queueGame(&game, 1);
+    apiCall("state");
+    CHECK(apiStateComplete());
+
+    // A move cuts a slow poll short, with part of the snapshot already in clientState
+    hostSetChunk(16);
+    game.activePlayer = 0;
+    queueGame(&game, 2);
+    getStateFromServer();
+    waitvsync();
+    getStateFromServer();
+    CHECK(apiReceivingState());
+    queueCommand("attack/3");
+    CHECK(!apiBusy());
+    CHECK(!apiStateComplete());
+
+    // The move's response is a full snapshot, which makes clientState whole again
+    hostSetChunk(0);
+    queueGame(&game, 3);
+    flushCommands();
+    CHECK(strcmp(lastRequest(), "attack/3?table=t1&player=ann&bin=1&v=" API_CLIENT_VERSION "&seq=0") == 0);
+    CHECK(apiStateComplete());
+}
+
+static void testCommandQueue()
+{
+    Game game;
+
+    makeGame(&game, 2, STATUS_GAMESTART, 0);
+
+    // Toggled back before it was sent
+    queueCommand("ready");
+    queueCommand("ready");
+    flushCommands();
+    CHECK(hostStats.opens == 0);
+
+    // A newer attack replaces the queued one
+    queueCommand("attack/1");
+    queueCommand("attack/2");
+    queueGame(&game, 1);
+    flushCommands();
+    CHECK(hostStats.opens == 1);
+    CHECK(requestIs("attack/2?"));
+
+    // A ready that went out but got no reply may have toggled on the server, so it is not sent again
+    hostQueueResponse((const uint8_t *)"", 0);
+    queueCommand("ready");
+    flushCommands();
+    CHECK(hostStats.opens == 2);
+    CHECK(requestIs("ready?"));
+
+    // A failing command is dropped after a few tries
+    queueCommand("attack/3");
+    flushCommands();
+    CHECK(hostStats.opens == 2 + API_COMMAND_TRIES);
+
+    // The player waits on a leave, so it is only tried once
+    queueCommand("leave");
+    flushCommands();
+    CHECK(hostStats.opens == 3 + API_COMMAND_TRIES);
+}
+
+static void testNetworkStats()
+{
+    Game game;
+
+    makeGame(&game, 2, STATUS_GAMESTART, 0);
+    queueGame(&game, 1);
+    apiCall("state");
+    hostQueueError();
+    apiCall("state");
+    CHECK(apiStats.endpoints[API_EP_STATE].requests == 2);
+    CHECK(apiStats.endpoints[API_EP_STATE].failures == 1);
+    CHECK(apiStats.endpoints[API_EP_STATE].bytes == API_HEADER_SIZE + sizeof(Game));
+    CHECK(apiStats.endpoints[API_EP_STATE].rtt[0] == 1);
+
+    // An attack whose response trickles in over 8 frames lands in the 4-7 jiffies bucket
+    hostSetChunk(30);
+    queueGame(&game, 2);
+    apiCall("attack/5");
+    CHECK(apiStats.endpoints[API_EP_ATTACK].requests == 1);
+    CHECK(apiStats.endpoints[API_EP_ATTACK].rtt[2] == 1);
+    hostSetChunk(0);
+
+    // The upload goes with the next poll, and counting starts afresh
+    queueStatsUpload();
+    CHECK(apiStats.endpoints[API_EP_ATTACK].requests == 0);
+    queueGame(&game, 3);
+    while (getStateFromServer() == STATE_UPDATE_PENDING)
+        ;
+    CHECK(requestIs("stats/host/2.1_0.0_1.0_0.0/0.0.1.0.0.0.0.0?table=t1&player=ann&"));
+
+    // The upload is not counted as a state poll
+    CHECK(apiStats.endpoints[API_EP_STATE].requests == 0);
+
+    // A command does not cut an upload short
+    apiStats.endpoints[API_EP_ATTACK].requests = 1;
+    queueStatsUpload();
+    hostSetChunk(16);
+    queueGame(&game, 4);
+    getStateFromServer();
+    queueCommand("attack/6");
+    CHECK(apiBusy());
+    while (getStateFromServer() == STATE_UPDATE_PENDING)
+        ;
+    CHECK(requestIs("stats/host/0.0_0.0_1.0_"));
+    hostSetChunk(0);
+    queueGame(&game, 5);
+    flushCommands();
+    CHECK(requestIs("attack/6?"));
+
+    // An upload that fails goes again with the next poll
+    queueStatsUpload();
+    hostQueueError();
+    getStateFromServer();
+    queueGame(&game, 6);
+    while (getStateFromServer() == STATE_UPDATE_PENDING)
+        ;
+    CHECK(requestIs("stats/host/"));
+    queueGame(&game, 6);
+    while (getStateFromServer() == STATE_UPDATE_PENDING)
+        ;
+    CHECK(requestIs("state?"));
+}
+
+/*****************************************************************
+ * Sockets
+ *****************************************************************/
+
+static bool writeIs(const char *text)
+{
+    return strncmp((const char *)hostLastWrite, text, strlen(text)) == 0;
+}
+
+/// @brief Runs a background poll to the end
+static uint8_t pollToEnd()
+{
+    static uint8_t result;
+
+    while ((result = getStateFromServer()) == STATE_UPDATE_PENDING)
+        waitvsync();
+    return result;
+}
+
+static void testSessionChannel()
+{
+    Game game;
+    uint8_t i;
+
+    // No channel for an https endpoint, as FujiNet tcp sockets have no TLS
+    CHECK(!apiChannelAvailable());
+
+    strcpy(serverEndpoint, "http://host.test/");
+    resetApiSession();
+    CHECK(apiChannelAvailable());
+    hostAcceptSockets(true);
+
+    makeGame(&game, 2, STATUS_GAMESTART, 0);
+    queueGame(&game, 1);
+    CHECK(apiCall("state") == API_CALL_SUCCESS);
+    CHECK(memcmp(&clientState.game, &game, sizeof(Game)) == 0);
+    CHECK(hostStats.opens == 0 && hostStats.sockets == 1);
+    CHECK(writeIs("GET /state?table=t1&player=ann&bin=1&v=" API_CLIENT_VERSION "&seq=0 HTTP/1.1\r\nHost: host.test:80\r\n\r\n"));
+
+    // The next call reuses the connection, with the headers and body coming in a few bytes a frame
+    hostSetChunk(7);
+    game.activePlayer = 1;
+    queueGame(&game, 2);
+    CHECK(apiCall("attack/5") == API_CALL_SUCCESS);
+    CHECK(clientState.game.activePlayer == 1);
+    CHECK(hostStats.sockets == 1);
+    CHECK(writeIs("GET /attack/5?table=t1&player=ann&bin=1&v=" API_CLIENT_VERSION "&seq=1 HTTP/1.1\r\n"));
+    hostSetChunk(0);
+
+    // The server closed the idle connection, so the next call reconnects
+    hostDropSocket();
+    queueGame(&game, 3);
+    CHECK(apiCall("state") == API_CALL_SUCCESS);
+    CHECK(hostStats.sockets == 2);
+
+    // An error status fails the call
+    hostQueueError();
+    CHECK(apiCall("state") == API_CALL_ERROR);
+    CHECK(clientState.firstByte == 0);
+
+    // The longest request fits: a stats upload of capped counts, before the server issued a token
+    strcpy(serverEndpoint, "http://a-rather-long-host-name.test/battleship-2/");
+    strcpy(query, "?table=a-table-with-a-long-name&player=someone123");
+    resetApiSession();
+    memset(apiStats.endpoints, 0, sizeof(apiStats.endpoints));
+    for (i = 0; i < API_EP_COUNT; i++)
+        apiStats.endpoints[i].requests = apiStats.endpoints[i].failures = apiStats.endpoints[API_EP_ATTACK].rtt[i] = 5000;
+    queueStatsUpload();
+    queueGame(&game, 4);
+    CHECK(pollToEnd() == STATE_UPDATE_CHANGE);
+    CHECK(writeIs("GET /battleship-2/stats/host/999.999_999.999_999.999_999.999/999.999.999.999.0.0.0.0?table="));
+    CHECK(strcmp((const char *)hostLastWrite + hostLastWriteLen - 4, "\r\n\r\n") == 0);
+
+    // A server that takes no raw connections is reached over http for the rest of the table
+    strcpy(serverEndpoint, "http://host.test/");
+    strcpy(query, "?table=t1&player=ann");
+    resetApiSession();
+    hostAcceptSockets(false);
+    queueGame(&game, 5);
+    CHECK(apiCall("state") == API_CALL_SUCCESS);
+    CHECK(requestIs("state?table=t1"));
+    hostAcceptSockets(true);
+    queueGame(&game, 6);
+    CHECK(apiCall("state") == API_CALL_SUCCESS);
+    CHECK(hostStats.opens == 2);
+}
+
+static void testPushNotify()
+{
+    Game game;
+    bool changed;
+    uint8_t i;
+
+    hostAcceptSockets(true);
+    makeGame(&game, 2, STATUS_GAMESTART, 1);
+    queueFull(&game, sizeof(Game), 1, API_CAP_PUSH | API_CAP_LONGPOLL, 0);
+    apiCall("state");
+    CHECK(canLongPoll());
+
+    // The next poll subscribes to the table, and with changes pushed there is no need to long-poll
+    queueFull(&game, sizeof(Game), 1, API_CAP_PUSH | API_CAP_LONGPOLL, 0);
+    CHECK(pollToEnd() == STATE_UPDATE_NOCHANGE);
+    CHECK(hostStats.sockets == 1);
+    CHECK(strcmp((const char *)hostLastWrite, query) == 0);
+    CHECK(!canLongPoll());
+    CHECK(nextPollDelay(0) == API_PUSH_POLL_FRAMES);
+
+    // Word of the state already held is not news, the channel is checked every few frames
+    hostPush(1);
+    changed = false;
+    for (i = 0; i < API_PUSH_CHECK_FRAMES; i++)
+        changed |= checkPush();
+    CHECK(!changed);
+
+    hostPush(1);
+    hostPush(2);
+    for (i = 0; i < API_PUSH_CHECK_FRAMES - 1; i++)
+        CHECK(!checkPush());
+    CHECK(checkPush());
+
+    // Without sockets, the client keeps polling for the rest of the table
+    resetApiSession();
+    hostAcceptSockets(false);
+    queueFull(&game, sizeof(Game), 1, API_CAP_PUSH | API_CAP_LONGPOLL, 0);
+    apiCall("state");
+    queueFull(&game, sizeof(Game), 1, API_CAP_PUSH | API_CAP_LONGPOLL, 0);
+    pollToEnd();
+    CHECK(canLongPoll());
+}
+
+static void testBinarySession()
+{
+    static const uint8_t hello[] = {API_OP_HELLO, 't', 'k', '0', '1', 4, 0};
+    static const uint8_t attack[] = {API_OP_ATTACK, 42};
+    static const uint8_t place[] = {API_OP_PLACE, 0, 10, 20, 30, 40};
+    Game game;
+
+    // The first call issues the token over http
+    hostAcceptSockets(true);
+    makeGame(&game, 2, STATUS_GAMESTART, 0);
+    queueFull(&game, sizeof(Game), 4, API_CAP_TOKEN | API_CAP_BINARY, 0);
+    CHECK(apiCall("state") == API_CALL_SUCCESS);
+    CHECK(hostStats.opens == 1 && hostStats.sockets == 0);
+
+    // Then calls go to the binary port, starting with a hello naming the session and its state
+    game.activePlayer = 1;
+    queueFull(&game, sizeof(Game), 5, API_CAP_BINARY, 0);
+    apiStart("attack/42");
+    CHECK(hostLastWriteLen == sizeof(hello) && memcmp(hostLastWrite, hello, sizeof(hello)) == 0);
+    while (apiUpdate() == API_CALL_PENDING)
+        ;
+    CHECK(clientState.game.activePlayer == 1);
+    CHECK(hostStats.opens == 1 && hostStats.sockets == 1 && hostStats.writes == 2);
+    CHECK(hostLastWriteLen == sizeof(attack) && memcmp(hostLastWrite, attack, sizeof(attack)) == 0);
+
+    // A response frame split over a few frames
+    hostSetChunk(5);
+    queueFull(&game, sizeof(Game), 6, API_CAP_BINARY, 0);
+    CHECK(apiCall("place/0,10,20,30,40") == API_CALL_SUCCESS);
+    CHECK(hostLastWriteLen == sizeof(place) && memcmp(hostLastWrite, place, sizeof(place)) == 0);
+    CHECK(hostStats.sockets == 1);
+    hostSetChunk(0);
+
+    // An empty frame fails the call, and the session goes back to http for the rest of the table
+    hostQueueError();
+    CHECK(apiCall("state") == API_CALL_ERROR);
+    queueFull(&game, sizeof(Game), 7, API_CAP_TOKEN | API_CAP_BINARY, 0);
+    CHECK(apiCall("state") == API_CALL_SUCCESS);
+    queueFull(&game, sizeof(Game), 7, API_CAP_BINARY, 0);
+    CHECK(apiCall("state") == API_CALL_SUCCESS);
+    CHECK(hostStats.opens == 3 && hostStats.sockets == 1);
+    CHECK(strcmp(lastRequest(), "s/tk01?seq=7") == 0);
+
+    // The hello goes out whenever the session connects
+    resetApiSession();
+    queueFull(&game, sizeof(Game), 4, API_CAP_TOKEN | API_CAP_BINARY, 0);
+    apiCall("state");
+    hostQueueError();
+    hostQueueError();
+    apiCall("state");
+    CHECK(hostStats.sockets == 2 && hostLastWriteLen == 1 && hostLastWrite[0] == API_OP_STATE);
+}
+
+/*****************************************************************
+ * Rendering
+ *****************************************************************/
+
+static void testLobby()
+{
+    Lobby lobby;
+
+    makeLobby(&lobby, 2, 1);
+    queueFull(&lobby, sizeof(Lobby), 1, 0, 0);
+    apiCall("state");
+    processStateChange();
+
+    CHECK(hostScreenHas("host test table"));
+    CHECK(hostScreenHas("waiting for players"));
+    CHECK(hostScreenHas("ann"));
+    CHECK(hostScreenHas("bob"));
+    CHECK(hostScreenHas("ready"));
+
+    // A player leaving is erased
+    lobby.playerCount = 1;
+    queueFull(&lobby, sizeof(Lobby), 2, 0, 0);
+    apiCall("state");
+    processStateChange();
+    CHECK(!hostScreenHas("bob"));
+}
+
+static void testShadowScreen()
+{
+    Lobby lobby;
+    uint32_t chars;
+
+    // Nothing is drawn until the vsync, and then only what changed
+    resetScreen();
+    drawText(1, 1, "abc");
+    CHECK(hostStats.chars == 0);
+    waitvsync();
+    CHECK(hostStats.chars == 3);
+    CHECK(strncmp(hostRow(1), " abc ", 5) == 0);
+
+    drawText(1, 1, "abd");
+    drawIcon(0, 1, ' ');
+    waitvsync();
+    CHECK(hostStats.chars == 5);
+    CHECK(strncmp(hostRow(1), " abd ", 5) == 0);
+
+    // A capped flush stops part way along a row, and the next one carries on from there
+    drawText(0, 2, "wxyz");
+    drawText(0, 3, "ab");
+    CHECK(!flushScreenCells(3));
+    CHECK(hostStats.chars == 8);
+    CHECK(!flushScreenCells(2));
+    CHECK(hostStats.chars == 10);
+    CHECK(flushScreenCells(2));
+    CHECK(hostStats.chars == 11);
+    CHECK(flushScreenCells(0));
+    CHECK(strncmp(hostRow(2), "wxyz", 4) == 0);
+    CHECK(strncmp(hostRow(3), "ab", 2) == 0);
+
+    // Drawing the same lobby again only moves bob's waiting mark along: its old cell and its new one
+    makeLobby(&lobby, 2, 1);
+    queueFull(&lobby, sizeof(Lobby), 1, 0, 0);
+    apiCall("state");
+    processStateChange();
+    waitvsync();
+    chars = hostStats.chars;
+    processStateChange();
+    waitvsync();
+    CHECK(hostStats.chars - chars == 2);
+    CHECK(hostScreenHas("bob"));
+}
+
+static void testDrawQueue()
+{
+    uint8_t i;
+
+    // Nothing is drawn until the drain
+    for (i = 0; i < 3; i++)
+        queueText(0, 1, "0123456789abcdefghijklmnopqrstuvwxyz", CELL_TEXT);
+    CHECK(hostStats.chars == 0);
+    drainDrawQueue();
+    CHECK(hostStats.chars == 108);
+
+    // Then in order, the text wrapping around the end of its ring
+    queueText(0, 2, "0123456789abcdefghijklmnopqrstuvwxyz", CELL_TEXT);
+    queueSpace(4, 2, 3);
+    queueCell(5, 2, '*', CELL_ICON);
+    drainDrawQueue();
+    CHECK(strncmp(hostRow(2), "0123 * 789", 10) == 0);
+    CHECK(strncmp(hostRow(2) + 30, "uvwxyz", 6) == 0);
+
+    // A full queue draws what it has to make room
+    for (i = 0; i < 40; i++)
+        queueCell(i, 3, 'a' + i % 26, CELL_ICON);
+    CHECK(hostStats.chars == 108 + 36 + 3 + 1 + 32);
+    CHECK(hostRow(3)[0] == 'a');
+    drainDrawQueue();
+    CHECK(hostRow(3)[39] == 'n');
+
+    queueText(0, 4, "dropped", CELL_TEXT);
+    clearDrawQueue();
+    drainDrawQueue();
+    CHECK(!hostScreenHas("dropped"));
+}
+
+static void testGameStart()
+{
+    Game game;
+
+    makeGame(&game, 3, STATUS_GAMESTART, 0);
+    setCell(game.players[1].gamefield, 7, FIELD_MISS);
+    queueGame(&game, 1);
+    apiCall("state");
+    processStateChange();
+
+    CHECK(hostStats.boards == 1);
+
+    // The gamefields follow, one a frame, while the poll and input carry on
+    CHECK(hostStats.gamefields == 0);
+    renderTask();
+    CHECK(hostStats.gamefields == 1);
+    renderTask();
+    renderTask();
+    CHECK(hostStats.gamefields == 3);
+    CHECK(!redrawBusy());
+    CHECK(hostField[1][7] == FIELD_MISS);
+    CHECK(hostField[1][8] == 0);
+    CHECK(memcmp(state.gamefield[1], game.players[1].gamefield, FIELD_PACKED_SIZE) == 0);
+}
+
+static void testRedrawFlushesRest()
+{
+    Game game;
+
+    // With a few cells drawn per vsync, the end of a full board redraw draws what is left
+    hostFlushCells = 2;
+    makeGame(&game, 3, STATUS_GAMESTART, 0);
+    queueGame(&game, 1);
+    apiCall("state");
+    processStateChange();
+    drawText(0, 2, "more than a few cells");
+    waitvsync();
+    CHECK(!flushScreenCells(0));
+
+    runTimeline(10);
+    CHECK(!redrawBusy());
+    CHECK(flushScreenCells(0));
+}
+
+static void testRedrawInterrupted()
+{
+    Game game;
+    Lobby lobby;
+
+    makeGame(&game, 3, STATUS_GAMESTART, 1);
+    queueGame(&game, 1);
+    apiCall("state");
+    processStateChange();
+    renderTask();
+
+    // A newer state mid redraw: the gamefields still to come show it
+    game.status = STATUS_MISS;
+    game.activePlayer = 2;
+    game.lastAttackPos = 9;
+    setCell(game.players[2].gamefield, 9, FIELD_MISS);
+    queueGame(&game, 2);
+    apiCall("state");
+    processStateChange();
+    CHECK(redrawBusy());
+    timelineFinish();
+    renderTask();
+    renderTask();
+    CHECK(!redrawBusy());
+    CHECK(hostStats.gamefields == 3);
+    CHECK(hostField[2][9] == FIELD_MISS);
+
+    // A redraw starts over when the board is drawn again, and is dropped when the board goes away
+    state.drawBoard = true;
+    processStateChange();
+    renderTask();
+    CHECK(hostStats.gamefields == 4);
+    makeLobby(&lobby, 2, 1);
+    queueFull(&lobby, sizeof(Lobby), 3, 0, 0);
+    apiCall("state");
+    processStateChange();
+    CHECK(!redrawBusy());
+    renderTask();
+    CHECK(hostStats.gamefields == 4);
+}
+
+/// @brief Bob attacks cell 33 and hits cy, with cy's last ship sunk if sink
+static void playAttack(bool sink)
+{
+    Game game;
+
+    makeGame(&game, 3, STATUS_GAMESTART, 1);
+    queueGame(&game, 1);
+    apiCall("state");
+    processStateChange();
+
+    game.status = STATUS_HIT;
+    game.activePlayer = 2;
+    game.lastAttackPos = 33;
+    setCell(game.players[0].gamefield, 33, FIELD_MISS);
+    setCell(game.players[2].gamefield, 33, FIELD_ATTACK);
+    if (sink)
+        game.players[2].shipsLeft[4] = 0;
+    queueGame(&game, 2);
+    apiCall("state");
+
+    hostStats.frames = hostStats.cellUpdates = 0;
+    processStateChange();
+
+    // The change is drawn without waiting, and the animation plays out in the main loop
+    CHECK(hostStats.frames == 0);
+    CHECK(timelineBusy());
+    runTimeline(200);
+
+    CHECK(hostField[0][33] == FIELD_MISS);
+    CHECK(hostField[1][33] == 0);
+    CHECK(hostField[2][33] == FIELD_ATTACK);
+    CHECK(hostStats.cellUpdates > 2);
+    CHECK(hostStats.frames > 30);
+}
+
+static void testAttackAnimation()
+{
+    playAttack(false);
+    CHECK(strcmp(hostLastSound, "hit") == 0);
+}
+
+static void testSinkAnimation()
+{
+    playAttack(true);
+    CHECK(strcmp(hostLastSound, "sink") == 0);
+}
+
+static void testAnimationInterrupted()
+{
+    Game game;
+
+    makeGame(&game, 3, STATUS_GAMESTART, 1);
+    queueGame(&game, 1);
+    apiCall("state");
+    processStateChange();
+
+    game.status = STATUS_HIT;
+    game.activePlayer = 2;
+    game.lastAttackPos = 33;
+    setCell(game.players[2].gamefield, 33, FIELD_ATTACK);
+    queueGame(&game, 2);
+    apiCall("state");
+    processStateChange();
+    runFrames(10);
+    CHECK(hostField[2][33] > 9);
+
+    // The next state arrives mid-animation, which jumps to the end without its sound
+    game.moveTime = 5;
+    queueGame(&game, 3);
+    apiCall("state");
+    processStateChange();
+    CHECK(hostField[2][33] == FIELD_ATTACK);
+    CHECK(hostField[0][33] == 0);
+    CHECK(strcmp(hostLastSound, "hit") != 0);
+}
+
+static void testGameOver()
+{
+    Game game;
+    Lobby lobby;
+
+    makeGame(&game, 2, STATUS_GAMEOVER, 1);
+    strcpy(game.prompt, "bob wins");
+    queueGame(&game, 1);
+    makeLobby(&lobby, 2, 0);
+    queueFull(&lobby, sizeof(Lobby), 2, 0, 0);
+
+    // The result stays up until the player presses the trigger, while the polls carry on
+    pollNow(1000);
+    CHECK(hostScreenHas("bob wins"));
+    CHECK(strcmp(hostLastSound, "gameDone") == 0);
+    CHECK(clientState.game.status == STATUS_LOBBY);
+
+    hostJoystickScript(pressTrigger, sizeof(pressTrigger), false);
+    runFrames(5);
+    CHECK(!hostScreenHas("bob wins"));
+    CHECK(hostScreenHas("host test table"));
+}
+
+static void testGameOverWaits()
+{
+    Game game;
+
+    makeGame(&game, 2, STATUS_HIT, 1);
+    queueGame(&game, 1);
+    apiCall("state");
+    processStateChange();
+    runTimeline(1000);
+
+    // The last attack sinks bob's last ship
+    game.status = STATUS_GAMEOVER;
+    game.activePlayer = 0;
+    game.lastAttackPos = 2;
+    setCell(game.players[1].gamefield, 2, FIELD_ATTACK);
+    memset(game.players[1].shipsLeft, 0, 5);
+    strcpy(game.prompt, "ann wins");
+    queueGame(&game, 2);
+    apiCall("state");
+    processStateChange();
+
+    // The result shows once the winning move played out, and a press before then does not close it
+    CHECK(timelineBusy());
+    CHECK(!hostScreenHas("ann wins"));
+    hostJoystickScript(pressTrigger, sizeof(pressTrigger), false);
+    runFrames(4);
+    runTimeline(1000);
+    CHECK(hostScreenHas("ann wins"));
+    CHECK(strcmp(hostLastSound, "gameDone") == 0);
+    CHECK(state.waitingOnEndGameContinue);
+}
+
+/*****************************************************************
+ * Attacking
+ *****************************************************************/
+
+static void startMyTurn(uint8_t moveTime)
+{
+    Game game;
+
+    makeGame(&game, 2, STATUS_MISS, 0);
+    game.moveTime = moveTime;
+    setCell(game.players[1].gamefield, 0, FIELD_ATTACK);
+    queueGame(&game, 1);
+    apiCall("state");
+    processStateChange();
+}
+
+static void testPlayerMove()
+{
+    static const char keys[] = {KEY_RIGHT_ARROW, KEY_RIGHT_ARROW, KEY_DOWN_ARROW, KEY_SPACEBAR, 0};
+    Game game;
+
+    startMyTurn(20);
+    hostQueueKeys(keys);
+    runFlow(playerMoveTask, 2000);
+    CHECK(posX == 2 && posY == 1);
+    CHECK(strcmp(hostLastSound, "attack") == 0);
+
+    makeGame(&game, 2, STATUS_MISS, 1);
+    queueGame(&game, 2);
+    flushCommands();
+    CHECK(requestIs("attack/12?"));
+}
+
+static void testPlayerMoveInvalid()
+{
+    static const char keys[] = {KEY_SPACEBAR, KEY_RIGHT_ARROW, KEY_SPACEBAR, 0};
+    Game game;
+    uint32_t sounds;
+
+    // Cell 0 was already attacked
+    startMyTurn(20);
+    sounds = hostStats.sounds;
+    hostQueueKeys(keys);
+    runFlow(playerMoveTask, 2000);
+    CHECK(hostStats.sounds - sounds >= 4); // my turn, invalid, cursor, attack
+
+    makeGame(&game, 2, STATUS_MISS, 1);
+    queueGame(&game, 2);
+    flushCommands();
+    CHECK(requestIs("attack/1?"));
+}
+
+static void testPollWhileAiming()
+{
+    static uint32_t cursors;
+    Game game;
+
+    makeGame(&game, 2, STATUS_MISS, 0);
+    game.moveTime = 20;
+    queueGame(&game, 1);
+    pollNow(100);
+    CHECK(hostStats.cursors > 0);
+
+    // The server moves on while this player aims, which drops the cursor without attacking
+    game.activePlayer = 1;
+    queueGame(&game, 2);
+    pollNow(1000);
+    CHECK(clientState.game.activePlayer == 1);
+    CHECK(requestIs("state"));
+
+    cursors = hostStats.cursors;
+    runFrames(30);
+    CHECK(hostStats.cursors == cursors);
+}
+
+static void testPlayerMoveTimeout()
+{
+    uint32_t frames;
+
+    startMyTurn(2);
+    frames = hostStats.frames;
+    runFlow(playerMoveTask, 2000);
+    frames = hostStats.frames - frames;
+
+    CHECK(frames >= 60 && frames <= 2 * 60 + 10);
+    CHECK(state.moveTimeLeft == 0);
+    flushCommands();
+    CHECK(hostStats.opens == 1);
+}
+
+/*****************************************************************
+ * Screens and full flows
+ *****************************************************************/
+
+static void testTableSelection()
+{
+    static const uint8_t script[] = {0x02, 0, 0x10};
+    Tables tables;
+    Lobby lobby;
+
+    memset(&tables, 0, sizeof(tables));
+    tables.count = 2;
+    strcpy(tables.table[0].table, "t1");
+    strcpy(tables.table[0].name, "first table");
+    strcpy(tables.table[0].players, "1/4");
+    strcpy(tables.table[1].table, "t2");
+    strcpy(tables.table[1].name, "second table");
+    strcpy(tables.table[1].players, "0/4");
+    queueFull(&tables, sizeof(tables), 0, 0, 0);
+
+    makeLobby(&lobby, 1, 0);
+    queueFull(&lobby, sizeof(lobby), 1, 0, 0);
+
+    query[0] = 0;
+    hostJoystickScript(script, sizeof(script), false);
+    showTableSelectionScreen();
+
+    CHECK(strcmp(query, "?table=t2&player=ann") == 0);
+    CHECK(requestIs("state?table=t2&player=ann&bin=1&v="));
+    CHECK(state.inGame);
+    CHECK(clientState.lobby.playerCount == 1);
+
+    read_appkey(AK_LOBBY_CREATOR_ID, AK_LOBBY_APP_ID, AK_LOBBY_KEY_SERVER, tempBuffer);
+    CHECK(strcmp(tempBuffer, "https://host.test/?table=t2") == 0);
+}
+
+/// @brief Joins a table with responses captured from support/server/fbs_server.py (run from the repo root)
+static void testServerPayloads()
+{
+    CHECK(hostQueueResponseFile("tests/host/payloads/tables.bin"));
+    CHECK(hostQueueResponseFile("tests/host/payloads/lobby.bin"));
+    CHECK(hostQueueResponseFile("tests/host/payloads/lobby-v2.bin"));
+
+    query[0] = 0;
+    hostJoystickScript(pressTrigger, 3, false);
+    showTableSelectionScreen();
+    CHECK(strcmp(query, "?table=basement&player=ann") == 0);
+    CHECK(clientState.lobby.playerCount == 2);
+    CHECK(strcmp(clientState.lobby.serverName, "Basement Boat") == 0);
+    CHECK(strcmp(clientState.lobby.players[1].name, "bot1") == 0);
+    CHECK(clientState.lobby.players[1].ready);
+
+    // The server issued a token, and an older server's raw layout is understood as well
+    CHECK(apiCall("state") == API_CALL_SUCCESS);
+    CHECK(requestIs("s/"));
+    CHECK(strcmp(clientState.lobby.serverName, "Basement Boat") == 0);
+    CHECK(strcmp(clientState.lobby.players[0].name, "ann") == 0);
+}
+
+static void testFullGame()
+{
+    static uint8_t placeScript[1 + 5 * 3];
+    Lobby lobby;
+    Game game;
+    uint8_t i;
+
+    // Lobby, bob is ready
+    makeLobby(&lobby, 2, 0);
+    lobby.players[1].ready = 1;
+    queueFull(&lobby, sizeof(Lobby), 1, 0, 0);
+    runLoop(1000);
+    CHECK(hostScreenHas("host test table"));
+
+    // Ann readies up, the server starts the countdown
+    hostJoystickScript(pressTrigger, 3, false);
+    lobby.players[0].ready = 1;
+    strcpy(lobby.prompt, "starting in 3");
+    queueFull(&lobby, sizeof(Lobby), 2, 0, 0);
+    runLoop(1000);
+    CHECK(requestIs("ready?"));
+    CHECK(hostScreenHas("starting in 3"));
+
+    // Ship placement
+    // The frame that starts placing reads its input before the flow clears it, then a press per ship
+    for (i = 1; i < sizeof(placeScript); i += 3)
+        memcpy(placeScript + i, pressTrigger, 3);
+    hostJoystickScript(placeScript, sizeof(placeScript), false);
+    makeGame(&game, 2, STATUS_PLACE_SHIPS, -1);
+    game.playerStatus = PLAYER_STATUS_PLACE_SHIPS;
+    queueGame(&game, 3);
+    game.playerStatus = PLAYER_STATUS_DEFAULT;
+    queueGame(&game, 4);
+    pollNow(1000);
+    CHECK(shipPlaceIndex == 5);
+    CHECK(requestIs("place/"));
+
+    // Ann's turn - she attacks cell 1 and hits
+    hostQueueKeys("\x1D ");
+    makeGame(&game, 2, STATUS_GAMESTART, 0);
+    queueGame(&game, 5);
+    game.status = STATUS_HIT;
+    game.activePlayer = 1;
+    game.lastAttackPos = 1;
+    setCell(game.players[1].gamefield, 1, FIELD_ATTACK);
+    queueGame(&game, 6);
+    pollNow(3000);
+    CHECK(requestIs("attack/1?"));
+    CHECK(hostField[1][1] == FIELD_ATTACK);
+    CHECK(strcmp(hostLastSound, "hit") == 0);
+
+    // Bob is out of ships
+    hostJoystickScript(pressTrigger, sizeof(pressTrigger), true);
+    game.status = STATUS_GAMEOVER;
+    game.activePlayer = 0;
+    memset(game.players[1].shipsLeft, 0, 5);
+    strcpy(game.prompt, "ann wins");
+    queueGame(&game, 7);
+    pollNow(3000);
+    runTimeline(1000);
+    CHECK(hostScreenHas("ann wins"));
+    CHECK(strcmp(hostLastSound, "gameDone") == 0);
+}
+
+typedef struct
+{
+    const char *name;
+    void (*run)();
+} Test;
+
+static const Test tests[] = {
+    {"testShip bounds", testShipBounds},
+    {"ship placement", testShipPlacement},
+    {"full snapshot", testFullSnapshot},
+    {"patch", testPatch},
+    {"errors", testErrors},
+    {"session token", testSessionToken},
+    {"legacy payload", testLegacyPayload},
+    {"version negotiation", testVersionNegotiation},
+    {"background poll", testBackgroundPoll},
+    {"cut short read", testCutShortRead},
+    {"command queue", testCommandQueue},
+    {"network stats", testNetworkStats},
+    {"session channel", testSessionChannel},
+    {"push notify", testPushNotify},
+    {"binary session", testBinarySession},
+    {"lobby", testLobby},
+    {"shadow screen", testShadowScreen},
+    {"draw queue", testDrawQueue},
+    {"game start", testGameStart},
+    {"redraw flushes rest", testRedrawFlushesRest},
+    {"redraw interrupted", testRedrawInterrupted},
+    {"attack animation", testAttackAnimation},
+    {"sink animation", testSinkAnimation},
+    {"animation interrupted", testAnimationInterrupted},
+    {"game over", testGameOver},
+    {"game over waits", testGameOverWaits},
+    {"player move", testPlayerMove},
+    {"player move invalid", testPlayerMoveInvalid},
+    {"poll while aiming", testPollWhileAiming},
+    {"player move timeout", testPlayerMoveTimeout},
+    {"table selection", testTableSelection},
+    {"server payloads", testServerPayloads},
+    {"full game", testFullGame},
+};
+
+int main(int argc, char **argv)
+{
+    // Kept in memory, as a test that runs out of frames longjmps back into the loop
+    volatile uint8_t i;
+
+    for (i = 0; i < sizeof(tests) / sizeof(tests[0]); i++)
+    {
+        currentTest = tests[i].name;
+        testFailed = false;
+        fixtureReset();
+        hostFrameLimit = TEST_FRAME_LIMIT;
+        hostEscape = &escape;
+
+        if (setjmp(escape))
+            check(false, "finished within the frame limit", 0);
+        else
+            tests[i].run();
+
+        hostFrameLimit = 0;
+        printf("%s %s\n", testFailed ? "FAIL" : "ok  ", currentTest);
+    }
+
+    printf("\n%u tests, %u checks, %u failed\n", i, checks, failed);
+    return failed != 0;
+}
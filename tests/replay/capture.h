@@ -0,0 +1,28 @@
+/*
+  Capture file format - the calls of one client session, as recorded by the VICE bridge
+  (support/c64/fuji_mock_network.py --capture) or the swarm players (--capture), and played
+  back by tests/replay.
+
+  The file starts with CAPTURE_MAGIC, then one record per call: a CaptureRecord header,
+  the devicespec (urlLen bytes, no terminator), then the response body (bodyLen bytes).
+  All fields are little endian.
+*/
+#ifndef CAPTURE_H
+#define CAPTURE_H
+
+#include <stdint.h>
+
+#define CAPTURE_MAGIC "FBC1"
+#define CAPTURE_MAGIC_LEN 4
+#define CAPTURE_NO_RESPONSE 0xFFFF // bodyLen of a call that failed or was never answered
+
+typedef struct
+{
+    uint32_t ms;      // When the response arrived, in ms since the capture started
+    uint16_t urlLen;
+    uint16_t bodyLen;
+} CaptureRecord;
+
+_Static_assert(sizeof(CaptureRecord) == 8, "CaptureRecord is written as is");
+
+#endif /* CAPTURE_H */
@@ -0,0 +1,187 @@
+/*
+  Network and appkey calls for the replayer (CUSTOM_FUJINET_CALLS), in place of src/host/network.c.
+  Each network_open() is answered with the next call of the capture, whatever was asked for, so
+  the client sees the same responses in the same order as the recorded session. In real time the
+  response only arrives once the game clock reaches the time it arrived in the capture.
+*/
+
+#include <stdio.h>
+#include "../../src/misc.h"
+#include "../../src/fujinet-network.h"
+#include "../../src/host/host.h"
+#include "capture.h"
+#include "replay.h"
+
+char hostLastUrl[256];
+
+static uint8_t *capture, *next, *end;
+static uint32_t firstMs, startFrame;
+static const CaptureRecord *current; // Record being read, NULL if none is open
+static const uint8_t *body;
+static uint16_t readPos;
+static uint32_t dueFrame;
+
+void hostResetNetwork()
+{
+    current = NULL;
+}
+
+bool replayLoad(const char *path)
+{
+    static FILE *f;
+    static long size;
+
+    f = fopen(path, "rb");
+    if (f == NULL)
+        return false;
+
+    fseek(f, 0, SEEK_END);
+    size = ftell(f);
+    fseek(f, 0, SEEK_SET);
+    capture = malloc(size);
+    if (capture == NULL || size < CAPTURE_MAGIC_LEN || fread(capture, 1, size, f) != (size_t)size ||
+        memcmp(capture, CAPTURE_MAGIC, CAPTURE_MAGIC_LEN))
+    {
+        fclose(f);
+        return false;
+    }
+    fclose(f);
+
+    next = capture + CAPTURE_MAGIC_LEN;
+    end = capture + size;
+    firstMs = next + sizeof(CaptureRecord) <= end ? ((CaptureRecord *)next)->ms : 0;
+    return true;
+}
+
+void replayStart()
+{
+    startFrame = hostStats.frames;
+}
+
+bool replayDone()
+{
+    return next + sizeof(CaptureRecord) > end;
+}
+
+/// @brief The path of a devicespec up to its query, e.g. "attack/5" of n:http://host/attack/5?table=t1
+static const char *requestPath(const char *url, uint16_t len, uint16_t *pathLen)
+{
+    static const char *p, *stop;
+
+    stop = url + len;
+    p = url;
+    while (p + 2 < stop && !(p[0] == ':' && p[1] == '/' && p[2] == '/'))
+        p++;
+    p += 3;
+    while (p < stop && *p != '/')
+        p++;
+
+    *pathLen = 0;
+    while (p + *pathLen < stop && p[*pathLen] != '?')
+        (*pathLen)++;
+    return p;
+}
+
+uint8_t custom_network_open(char *devicespec, uint8_t mode, uint8_t trans)
+{
+    static const CaptureRecord *record;
+    static const char *url, *wanted, *got;
+    static uint16_t wantedLen, gotLen;
+
+    // Captures hold http calls only, so the client falls back from its tcp session and udp push sockets
+    if (strncmp(devicespec, "n:http", 6))
+        return 1;
+
+    strncpy(hostLastUrl, devicespec, sizeof(hostLastUrl) - 1);
+    hostStats.opens++;
+    current = NULL;
+
+    if (replayDone())
+        return 1;
+
+    record = (const CaptureRecord *)next;
+    url = (const char *)next + sizeof(CaptureRecord);
+    body = (const uint8_t *)url + record->urlLen;
+    next = (uint8_t *)body + (record->bodyLen == CAPTURE_NO_RESPONSE ? 0 : record->bodyLen);
+    if (next > end)
+    {
+        next = end;
+        return 1;
+    }
+    replayStats.calls++;
+
+    // The client's own calls need not match the capture's (its input is not recorded), but count when they differ
+    wanted = requestPath(url, record->urlLen, &wantedLen);
+    got = requestPath(devicespec, (uint16_t)strlen(devicespec), &gotLen);
+    if (wantedLen != gotLen || memcmp(wanted, got, gotLen))
+        replayStats.diverged++;
+    if (replayOptions.trace)
+        printf("%7lu %-28.*s <- %-28.*s %5d bytes\n", (unsigned long)hostStats.frames, (int)gotLen, got,
+               (int)wantedLen, wanted, record->bodyLen == CAPTURE_NO_RESPONSE ? -1 : record->bodyLen);
+
+    if (record->bodyLen == CAPTURE_NO_RESPONSE)
+    {
+        replayStats.failed++;
+        return 1;
+    }
+
+    dueFrame = startFrame + (uint32_t)((uint64_t)(record->ms - firstMs) * replayOptions.fps / 1000);
+    current = record;
+    readPos = 0;
+    return 0;
+}
+
+uint8_t custom_network_status(char *devicespec, uint16_t *bw, uint8_t *c, uint8_t *err)
+{
+    if (current == NULL)
+        return 1;
+
+    // In real time, nothing arrives before the capture's time
+    if (replayOptions.realtime && hostStats.frames < dueFrame)
+    {
+        *bw = 0;
+        *c = 1;
+        *err = 1;
+        return 0;
+    }
+
+    *bw = current->bodyLen - readPos;
+    *c = readPos < current->bodyLen;
+    *err = *c ? 1 : 136; // EOF once everything was read
+    return 0;
+}
+
+int16_t custom_network_read_nb(char *devicespec, uint8_t *buf, uint16_t len)
+{
+    if (current == NULL)
+        return -1;
+
+    if (len > current->bodyLen - readPos)
+        len = current->bodyLen - readPos;
+
+    memcpy(buf, body + readPos, len);
+    readPos += len;
+    hostStats.bytesRead += len;
+    return len;
+}
+
+uint8_t custom_network_close(char *devicespec)
+{
+    current = NULL;
+    return 0;
+}
+
+/// @brief Not part of the custom calls, but the push subscription still references it. The replay never opens a push channel.
+uint8_t network_write(char *devicespec, uint8_t *buf, uint16_t len)
+{
+    return 1;
+}
+
+uint16_t custom_read_appkey(uint16_t creator_id, uint8_t app_id, uint8_t key_id, char *destination)
+{
+    return 0;
+}
+
+void custom_write_appkey(uint16_t creator_id, uint8_t app_id, uint8_t key_id, uint16_t count, char *data)
+{
+}
@@ -0,0 +1,174 @@
+/*
+  Replayer - plays a captured session (capture.h) back through the real state client and game
+  logic on the host platform, with no server.
+
+  It runs the tasks of main(), answering each call with the next captured response, and
+  draws every state change with processStateChange() as the player saw it. Where the game waits
+  on the player (placing ships, attacking, closing the result), the trigger is pressed for them.
+
+  At full speed (the default) this is a deterministic whole-game benchmark of the rendering,
+  reporting the cpu time per state change. With --realtime, frames are paced on the wall clock
+  and each response arrives when it did in the capture, to watch a field bug unfold with --trace.
+
+  Build and run with: make replay CAPTURE=file.fbc REPLAY_ARGS="--realtime --trace"
+*/
+
+#define _GNU_SOURCE
+
+// unistd.h has a pause() of its own, which the game's pause() in misc.h would clash with
+#define pause posixPause
+#include <setjmp.h>
+#include <time.h>
+#undef pause
+
+#include "../../src/misc.h"
+#include "../../src/stateclient.h"
+#include "../../src/gamelogic.h"
+#include "../../src/task.h"
+#include "../../src/host/host.h"
+#include "replay.h"
+
+#define GAME_MINUTES_MAX 600 // Frame limit past the end of the capture, in case a flow never returns
+
+ReplayStats replayStats;
+ReplayOptions replayOptions = {false, false, 60};
+
+static const uint8_t pressTrigger[] = {0, 0x10};
+static jmp_buf escape;
+
+static uint64_t cpuNanos()
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+/// @brief Frame hook: in real time, waits for the next frame on the wall clock
+static void paceFrame()
+{
+    static struct timespec next;
+
+    if (!next.tv_sec)
+        clock_gettime(CLOCK_MONOTONIC, &next);
+
+    next.tv_nsec += 1000000000 / replayOptions.fps;
+    while (next.tv_nsec >= 1000000000)
+    {
+        next.tv_nsec -= 1000000000;
+        next.tv_sec++;
+    }
+    clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &next, NULL);
+}
+
+static void printScreen()
+{
+    static uint8_t y;
+
+    for (y = 0; y < HEIGHT; y++)
+        printf("|%s|\n", hostRow(y));
+}
+
+static void usage(const char *name)
+{
+    printf("usage: %s [--realtime] [--trace] [--screen] [--fps 60] capture.fbc\n", name);
+    exit(2);
+}
+
+int main(int argc, char **argv)
+{
+    static uint32_t changes;
+    static uint64_t cpu, cpuMax, start, wallStart;
+    static struct timespec ts;
+    static bool showScreen;
+    const char *path = NULL;
+    int i;
+
+    for (i = 1; i < argc; i++)
+    {
+        if (!strcmp(argv[i], "--realtime"))
+            replayOptions.realtime = true;
+        else if (!strcmp(argv[i], "--trace"))
+            replayOptions.trace = true;
+        else if (!strcmp(argv[i], "--screen"))
+            showScreen = true;
+        else if (!strcmp(argv[i], "--fps") && i + 1 < argc)
+            replayOptions.fps = (uint16_t)atoi(argv[++i]);
+        else if (argv[i][0] != '-' && path == NULL)
+            path = argv[i];
+        else
+            usage(argv[0]);
+    }
+    if (path == NULL || !replayOptions.fps)
+        usage(argv[0]);
+
+    hostReset();
+    if (!replayLoad(path))
+    {
+        printf("Cannot read capture %s\n", path);
+        return 1;
+    }
+
+    // Joined as a player would be after the table selection screen, which is not replayed
+    memset(&clientState, 0, sizeof(clientState));
+    memset(&state, 0, sizeof(state));
+    strcpy(serverEndpoint, "http://replay/");
+    strcpy(playerName, "replay");
+    strcpy(query, "?table=replay&player=replay");
+    state.prevStatus = STATE_INVALID;
+    resetApiSession();
+
+    hostJoystickScript(pressTrigger, sizeof(pressTrigger), true);
+    if (replayOptions.realtime)
+        hostFrameHook = paceFrame;
+    hostEscape = &escape;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    wallStart = (uint64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+    replayStart();
+
+    // The tasks of main() (runTasks), until every captured response was drawn
+    state.apiCallWait = 0;
+    if (!setjmp(escape))
+    {
+        while (!replayDone() || apiBusy() || renderPending())
+        {
+            waitvsync();
+            pollTask();
+
+            start = cpuNanos();
+            if (renderTask())
+            {
+                start = cpuNanos() - start;
+                cpu += start;
+                if (start > cpuMax)
+                    cpuMax = start;
+                changes++;
+
+                // The last response is in, so give whatever flow it starts time to finish
+                if (replayDone())
+                    hostFrameLimit = hostStats.frames + GAME_MINUTES_MAX * 60 * replayOptions.fps;
+            }
+
+            // In the lobby the trigger would toggle ready, which the capture already has
+            if (clientState.game.status != STATUS_LOBBY)
+                processInput();
+        }
+    }
+    else
+        printf("Gave up on a flow that did not return %u minutes after the capture ended\n", GAME_MINUTES_MAX);
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    if (showScreen)
+        printScreen();
+
+    printf("calls            %8u (%u diverged from the capture, %u failed in it)\n", replayStats.calls,
+           replayStats.diverged, replayStats.failed);
+    printf("game time        %8.1f s (%lu frames), %.2f s wall\n", (double)hostStats.frames / replayOptions.fps,
+           (unsigned long)hostStats.frames, ((uint64_t)ts.tv_sec * 1000000000 + ts.tv_nsec - wallStart) / 1e9);
+    printf("state changes    %8u drawn, %.1f us cpu each, %.1f us max\n", changes,
+           changes ? cpu / 1000.0 / changes : 0.0, cpuMax / 1000.0);
+    printf("drawn            %8u chars, %u gamefields, %u cells, %u ships\n", hostStats.chars,
+           hostStats.gamefields, hostStats.cellUpdates, hostStats.ships);
+    return 0;
+}
@@ -0,0 +1,36 @@
+/*
+  Replayer - plays a captured session back through the real client (see capture.h)
+*/
+#ifndef REPLAY_H
+#define REPLAY_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+typedef struct
+{
+    uint32_t calls;    // Captured calls served
+    uint32_t diverged; // Served to a call other than the one captured (e.g. a poll where the player had attacked)
+    uint32_t failed;   // Captured calls that failed or were never answered
+} ReplayStats;
+
+typedef struct
+{
+    bool realtime; // Pace frames on the wall clock and hold each response until its captured time
+    bool trace;    // Print each call as it is served
+    uint16_t fps;
+} ReplayOptions;
+
+extern ReplayStats replayStats;
+extern ReplayOptions replayOptions;
+
+/// @brief Reads a capture file. Returns false if it cannot be read or is not a capture.
+bool replayLoad(const char *path);
+
+/// @brief Starts the capture's clock at the current frame
+void replayStart();
+
+/// @brief True once every captured call was served
+bool replayDone();
+
+#endif /* REPLAY_H */
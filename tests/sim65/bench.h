@@ -0,0 +1,19 @@
+/*
+  sim65 cycle benchmarks - each binary runs one op at a time, so run_bench.py can take the
+  simulator's cycle count of a run with the op, less a run with only its setup.
+*/
+#ifndef SIM65_BENCH_H
+#define SIM65_BENCH_H
+
+typedef struct
+{
+    const char *name;
+    void (*init)();  // Once, before the first iteration (may be NULL)
+    void (*setup)(); // Before each iteration, also in the skip run (may be NULL)
+    void (*op)();    // The work measured
+} BenchOp;
+
+/// @brief Usage: <binary> list | <op> <iterations> [skip]. Returns the exit code for main.
+int runBench(const BenchOp *ops, int argc, char **argv);
+
+#endif /* SIM65_BENCH_H */
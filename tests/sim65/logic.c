@@ -0,0 +1,124 @@
+/*
+  sim65 cycle benchmarks of the platform independent hot paths, built against src/host
+  (draws and network calls go to memory) and the host test fixtures.
+  Build and run with: make sim65
+*/
+
+#include "../host/fixtures.h"
+#include "bench.h"
+
+// stateclient.c assembles the request url here, only the host tests and benchmarks call it directly
+void buildRequest(const char *path);
+
+static Game gameA;
+static const uint8_t joystick[] = {0x08, 0, 0x10 | 0x01, 0}; // Right, release, fire+up, release
+static const uint8_t ships[5] = {0, 20, 140, 103, 88};
+
+static void initGame()
+{
+    fixtureReset();
+    makeGame(&gameA, 4, STATUS_HIT, 1);
+    gameA.lastAttackPos = 44;
+    setCell(gameA.players[0].gamefield, 44, FIELD_ATTACK);
+    setCell(gameA.players[1].gamefield, 45, FIELD_MISS);
+}
+
+static void initEmptyField()
+{
+    initGame();
+    memset(tempBuffer, 0, sizeof(tempBuffer));
+}
+
+static void opTestShip()
+{
+    static uint8_t pos;
+
+    pos = 0;
+    do
+        testShip(5, pos);
+    while (++pos < 200);
+}
+
+static void opPlaceShips()
+{
+    static uint8_t i;
+
+    for (i = 0; i < 5; i++)
+        placeShip(shipSize[i], ships[i]);
+}
+
+static void initInput()
+{
+    initGame();
+    hostJoystickScript(joystick, sizeof(joystick), true);
+}
+
+static void opReadCommonInput()
+{
+    readCommonInput();
+}
+
+static void initToken()
+{
+    initGame();
+    queueFull(&gameA, sizeof(Game), 1, API_CAP_TOKEN, 0);
+    apiCall("state");
+}
+
+static void opBuildPoll()
+{
+    buildRequest("state");
+}
+
+static void opBuildAttack()
+{
+    buildRequest("attack/42");
+}
+
+static void setupSnapshot()
+{
+    // Resets the response queue too, so the skip run never fills it
+    hostReset();
+    queueGame(&gameA, 1);
+}
+
+static void opApiCall()
+{
+    apiCall("state");
+}
+
+static void initSameState()
+{
+    initGame();
+    memcpy(&clientState.game, &gameA, sizeof(Game));
+    processStateChange();
+}
+
+static void setupRedraw()
+{
+    memcpy(&clientState.game, &gameA, sizeof(Game));
+    state.drawBoard = true;
+}
+
+static void opProcessStateChange()
+{
+    processStateChange();
+}
+
+static const BenchOp ops[] = {
+    {"testShip.sweep200", initEmptyField, NULL, opTestShip},
+    {"placeShip.5ships", initEmptyField, NULL, opPlaceShips},
+    {"readCommonInput", initInput, NULL, opReadCommonInput},
+    {"buildRequest.query.state", initGame, NULL, opBuildPoll},
+    {"buildRequest.query.attack", initGame, NULL, opBuildAttack},
+    {"buildRequest.token.state", initToken, NULL, opBuildPoll},
+    {"buildRequest.token.attack", initToken, NULL, opBuildAttack},
+    {"apiCall.snapshot", initGame, setupSnapshot, opApiCall},
+    {"processStateChange.same4", initSameState, NULL, opProcessStateChange},
+    {"processStateChange.redraw4", initGame, setupRedraw, opProcessStateChange},
+    {NULL}};
+
+int main(int argc, char **argv)
+{
+    return runBench(ops, argc, argv);
+}
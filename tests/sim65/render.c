@@ -0,0 +1,57 @@
+/*
+  sim65 cycle benchmarks of the char mode gamefield drawing, linked with one platform's graphics.c.
+  sim65 runs plain 6502 code against flat ram, so screen memory and hardware registers are just bytes.
+  Build and run with: make sim65
+*/
+
+#include "../../src/misc.h"
+#include "bench.h"
+
+static uint8_t field[FIELD_PACKED_SIZE];
+
+static void setCell(uint8_t pos, uint8_t value)
+{
+    field[pos >> 2] = (field[pos >> 2] & ~(3 << ((pos & 3) << 1))) | (value << ((pos & 3) << 1));
+}
+
+static void initBoard()
+{
+    static uint8_t pos;
+
+    // A board in mid game: every third cell missed, every seventh hit
+    for (pos = 0; pos < 100; pos++)
+    {
+        if (pos % 7 == 0)
+            setCell(pos, FIELD_ATTACK);
+        else if (pos % 3 == 0)
+            setCell(pos, FIELD_MISS);
+    }
+
+    drawBoard(4);
+}
+
+static void opDrawGamefield()
+{
+    drawGamefield(2, field);
+}
+
+static void opDrawUpdate()
+{
+    drawGamefieldUpdate(2, field, 49, 0);
+}
+
+static void opDrawUpdateAnim()
+{
+    drawGamefieldUpdate(2, field, 49, 12);
+}
+
+static const BenchOp ops[] = {
+    {"drawGamefield", initBoard, NULL, opDrawGamefield},
+    {"drawGamefieldUpdate.hit", initBoard, NULL, opDrawUpdate},
+    {"drawGamefieldUpdate.anim", initBoard, NULL, opDrawUpdateAnim},
+    {NULL}};
+
+int main(int argc, char **argv)
+{
+    return runBench(ops, argc, argv);
+}
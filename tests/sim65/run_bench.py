@@ -0,0 +1,113 @@
+"""
+Runs the sim65 cycle benchmarks and writes exact 6502 cycles per op as json.
+
+Each op is run twice under `sim65 -c`: once with the op, and once with only its
+init and setup (the `skip` argument). The difference over the iterations is the
+cost of the op alone, startup and setup cancel out.
+
+  python3 tests/sim65/run_bench.py --out build/sim65/cycles.json \\
+      --baseline tests/sim65/baseline.json build/sim65/logic.sim ...
+
+With --baseline, an op costing more than --tolerance percent over its baseline
+fails the run (exit 1). A missing baseline file is recorded from this run, to be
+committed. --record writes the results to the baseline instead.
+"""
+
+import argparse
+import json
+import os
+import re
+import subprocess
+import sys
+
+CYCLES = re.compile(r"(\d+)\s+cycles")
+
+
+def run(sim65, binary, args):
+    result = subprocess.run([sim65, "-c", binary] + args, capture_output=True, text=True)
+    output = result.stdout + result.stderr
+    if result.returncode != 0:
+        sys.exit(f"{binary} {' '.join(args)} failed ({result.returncode}):\n{output}")
+    return output
+
+
+def cycles(sim65, binary, args):
+    output = run(sim65, binary, args)
+    match = CYCLES.search(output)
+    if not match:
+        sys.exit(f"no cycle count from sim65 for {binary} {' '.join(args)}:\n{output}")
+    return int(match.group(1))
+
+
+def measure(sim65, binary, iterations):
+    results = {}
+    target = os.path.splitext(os.path.basename(binary))[0]
+    ops = [line.strip() for line in run(sim65, binary, ["list"]).splitlines()]
+
+    # sim65 -c adds its cycle count to the output, which is not an op
+    for op in [op for op in ops if op and not CYCLES.search(op)]:
+        total = cycles(sim65, binary, [op, str(iterations)])
+        setup = cycles(sim65, binary, [op, str(iterations), "skip"])
+        results[f"{target}/{op}"] = (total - setup) // iterations
+        print(f"{target + '/' + op:44} {results[target + '/' + op]:10}")
+
+    return results
+
+
+def compare(results, baseline, tolerance):
+    regressions = 0
+    for name, value in results.items():
+        if name not in baseline:
+            print(f"  new       {name}")
+            continue
+
+        limit = baseline[name] * (100 + tolerance) // 100
+        if value > limit:
+            print(f"  SLOWER    {name}: {baseline[name]} -> {value} cycles")
+            regressions += 1
+        elif value < baseline[name]:
+            print(f"  faster    {name}: {baseline[name]} -> {value} cycles")
+
+    for name in baseline:
+        if name not in results:
+            print(f"  missing   {name}")
+
+    return regressions
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("binaries", nargs="+", help="benchmark binaries built for sim6502")
+    parser.add_argument("--sim65", default="sim65")
+    parser.add_argument("--iterations", type=int, default=10)
+    parser.add_argument("--out", help="json file for the results")
+    parser.add_argument("--baseline", help="json file of expected cycles per op")
+    parser.add_argument("--tolerance", type=int, default=2, help="percent over the baseline allowed")
+    parser.add_argument("--record", action="store_true", help="write the results to the baseline")
+    args = parser.parse_args()
+
+    print(f"{'op':44} {'cycles/op':>10}")
+    results = {}
+    for binary in args.binaries:
+        results.update(measure(args.sim65, binary, args.iterations))
+
+    if args.out:
+        os.makedirs(os.path.dirname(args.out) or ".", exist_ok=True)
+        with open(args.out, "w") as f:
+            json.dump(results, f, indent=2, sort_keys=True)
+            f.write("\n")
+
+    if args.baseline and (args.record or not os.path.exists(args.baseline)):
+        with open(args.baseline, "w") as f:
+            json.dump(results, f, indent=2, sort_keys=True)
+            f.write("\n")
+        print(f"Recorded {len(results)} ops in {args.baseline}" + ("" if args.record else ", as there was no baseline - commit it"))
+    elif args.baseline:
+        with open(args.baseline) as f:
+            regressions = compare(results, json.load(f), args.tolerance)
+        if regressions:
+            sys.exit(f"{regressions} ops regressed past {args.tolerance}% of {args.baseline}")
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,52 @@
+/*
+  Command line for the sim65 benchmark binaries, see bench.h
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "bench.h"
+
+int runBench(const BenchOp *ops, int argc, char **argv)
+{
+    static const BenchOp *b;
+    static unsigned int i, iterations;
+    static unsigned char skip;
+
+    if (argc == 2 && !strcmp(argv[1], "list"))
+    {
+        for (b = ops; b->name; b++)
+            printf("%s\n", b->name);
+        return 0;
+    }
+
+    if (argc < 3)
+    {
+        printf("usage: %s list | <op> <iterations> [skip]\n", argv[0]);
+        return 2;
+    }
+
+    for (b = ops; b->name && strcmp(b->name, argv[1]); b++)
+        ;
+    if (!b->name)
+    {
+        printf("unknown op %s\n", argv[1]);
+        return 2;
+    }
+
+    iterations = atoi(argv[2]);
+    skip = argc > 3;
+
+    if (b->init)
+        b->init();
+
+    for (i = 0; i < iterations; i++)
+    {
+        if (b->setup)
+            b->setup();
+        if (!skip)
+            b->op();
+    }
+
+    return 0;
+}
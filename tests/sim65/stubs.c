@@ -0,0 +1,14 @@
+/*
+  Symbols the platform graphics.c files take from their assembly and the target runtime,
+  which the sim6502 target lacks. Only initGraphics() reads the charset, and it is not benchmarked.
+*/
+
+unsigned char charset[1];
+
+void waitvsync(void)
+{
+}
+
+void irqVsyncWait(void)
+{
+}
@@ -0,0 +1,265 @@
+/*
+  Network and appkey calls for the swarm players (CUSTOM_FUJINET_CALLS), in place of src/host/network.c.
+  Each network_open() sends an http GET over a kept-alive connection and waits for the whole
+  response, as FujiNet does before the open returns. network_status()/network_read_nb() then
+  hand the body out like a FujiNet http channel.
+*/
+
+#define _GNU_SOURCE
+
+// unistd.h has a pause() of its own, which the game's pause() in misc.h would clash with
+#define pause posixPause
+#include <errno.h>
+#include <netdb.h>
+#include <poll.h>
+#include <unistd.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+#undef pause
+
+#include "../../src/misc.h"
+#include "../../src/fujinet-network.h"
+#include "../../src/host/host.h"
+#include "../replay/capture.h"
+#include "swarm.h"
+
+#define RESPONSE_MAX 4096
+#define TIMEOUT_MS 20000 // Longer than any long-poll hold
+
+char hostLastUrl[256];
+
+static int sock = -1;
+static char host[64], port[8];
+static char response[RESPONSE_MAX];
+static uint16_t bodyLen, readPos;
+static uint8_t *body;
+static bool opened; // A response is ready to read
+static FILE *capture;
+static uint64_t captureStart;
+
+void hostResetNetwork()
+{
+    opened = false;
+}
+
+bool swarmCapture(const char *path)
+{
+    capture = fopen(path, "wb");
+    if (capture == NULL)
+        return false;
+
+    fwrite(CAPTURE_MAGIC, 1, CAPTURE_MAGIC_LEN, capture);
+    captureStart = swarmMicros();
+    return true;
+}
+
+/// @brief Appends a call to the capture, body NULL if it failed
+static void captureCall(const char *devicespec, const uint8_t *data, uint16_t len)
+{
+    CaptureRecord record;
+
+    record.ms = (uint32_t)((swarmMicros() - captureStart) / 1000);
+    record.urlLen = (uint16_t)strlen(devicespec);
+    record.bodyLen = data ? len : CAPTURE_NO_RESPONSE;
+    fwrite(&record, sizeof(record), 1, capture);
+    fwrite(devicespec, 1, record.urlLen, capture);
+    if (data)
+        fwrite(data, 1, len, capture);
+    fflush(capture);
+}
+
+static void disconnect()
+{
+    if (sock >= 0)
+        close(sock);
+    sock = -1;
+}
+
+static bool connectTo(const char *newHost, const char *newPort)
+{
+    struct addrinfo hints, *addrs;
+    int one = 1;
+
+    if (sock >= 0 && !strcmp(host, newHost) && !strcmp(port, newPort))
+        return true;
+
+    disconnect();
+    memset(&hints, 0, sizeof(hints));
+    hints.ai_family = AF_INET;
+    hints.ai_socktype = SOCK_STREAM;
+    if (getaddrinfo(newHost, newPort, &hints, &addrs))
+        return false;
+
+    sock = socket(addrs->ai_family, addrs->ai_socktype, addrs->ai_protocol);
+    if (sock >= 0 && connect(sock, addrs->ai_addr, addrs->ai_addrlen))
+        disconnect();
+    freeaddrinfo(addrs);
+    if (sock < 0)
+        return false;
+
+    setsockopt(sock, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+    strcpy(host, newHost);
+    strcpy(port, newPort);
+    swarmStats->connects++;
+    return true;
+}
+
+/// @brief Reads one http response into response. Returns its size, or 0 if the connection failed.
+static uint16_t readResponse()
+{
+    struct pollfd pfd = {sock, POLLIN, 0};
+    char *headerEnd, *p;
+    uint16_t len = 0, status, contentLen = 0;
+    ssize_t got;
+
+    for (;;)
+    {
+        if (poll(&pfd, 1, TIMEOUT_MS) != 1)
+            return 0;
+
+        got = recv(sock, response + len, RESPONSE_MAX - 1 - len, 0);
+        if (got <= 0)
+            return 0;
+        len += (uint16_t)got;
+        response[len] = 0;
+
+        headerEnd = strstr(response, "\r\n\r\n");
+        if (headerEnd == NULL)
+        {
+            if (len == RESPONSE_MAX - 1)
+                return 0;
+            continue;
+        }
+
+        p = strcasestr(response, "\r\ncontent-length:");
+        if (p && p < headerEnd)
+            contentLen = (uint16_t)atoi(p + 17);
+
+        body = (uint8_t *)headerEnd + 4;
+        if (body + contentLen > (uint8_t *)response + RESPONSE_MAX - 1)
+            return 0;
+        if (body + contentLen <= (uint8_t *)response + len)
+            break;
+    }
+
+    if (sscanf(response, "HTTP/%*s %hu", &status) != 1 || status != 200)
+        contentLen = 0;
+
+    p = strcasestr(response, "\r\nconnection: close");
+    if (p && p < headerEnd)
+        disconnect();
+
+    bodyLen = contentLen;
+    return len;
+}
+
+uint8_t custom_network_open(char *devicespec, uint8_t mode, uint8_t trans)
+{
+    static char request[512], newHost[64], newPort[8];
+    char *p, *path;
+    uint64_t start;
+    uint16_t received;
+    uint8_t attempt;
+    int len;
+
+    // Swarm players speak http only, so the client falls back from its tcp session and udp push sockets
+    if (strncmp(devicespec, "n:http", 6))
+        return 1;
+
+    strncpy(hostLastUrl, devicespec, sizeof(hostLastUrl) - 1);
+    hostStats.opens++;
+    opened = false;
+
+    // n:http://host[:port]/path
+    p = strstr(devicespec, "://");
+    if (p == NULL)
+        return 1;
+    p += 3;
+    path = strchr(p, '/');
+    if (path == NULL)
+        path = "/";
+    len = (int)(path - p);
+    snprintf(newHost, sizeof(newHost), "%.*s", len, p);
+    strcpy(newPort, "80");
+    if ((p = strchr(newHost, ':')) != NULL)
+    {
+        *p++ = 0;
+        snprintf(newPort, sizeof(newPort), "%s", p);
+    }
+
+    len = snprintf(request, sizeof(request), "GET %s HTTP/1.1\r\nHost: %s\r\n\r\n", path, newHost);
+    start = swarmMicros();
+
+    // A kept-alive connection the server since closed fails on first use, so try a fresh one once
+    for (attempt = 0; attempt < 2; attempt++)
+    {
+        if (!connectTo(newHost, newPort))
+            break;
+
+        if (send(sock, request, len, MSG_NOSIGNAL) == len && (received = readResponse()) != 0)
+        {
+            swarmRecordRequest((uint32_t)(swarmMicros() - start), len, received, bodyLen);
+            if (!bodyLen)
+                break;
+
+            if (capture)
+                captureCall(devicespec, body, bodyLen);
+            opened = true;
+            readPos = 0;
+            return 0;
+        }
+        disconnect();
+    }
+
+    if (capture)
+        captureCall(devicespec, NULL, 0);
+    swarmStats->errors++;
+    return 1;
+}
+
+uint8_t custom_network_status(char *devicespec, uint16_t *bw, uint8_t *c, uint8_t *err)
+{
+    if (!opened)
+        return 1;
+
+    *bw = bodyLen - readPos;
+    *c = readPos < bodyLen;
+    *err = *c ? 1 : 136; // EOF once everything was read
+    return 0;
+}
+
+int16_t custom_network_read_nb(char *devicespec, uint8_t *buf, uint16_t len)
+{
+    if (!opened)
+        return -1;
+
+    if (len > bodyLen - readPos)
+        len = bodyLen - readPos;
+
+    memcpy(buf, body + readPos, len);
+    readPos += len;
+    hostStats.bytesRead += len;
+    return len;
+}
+
+uint8_t custom_network_close(char *devicespec)
+{
+    opened = false;
+    return 0;
+}
+
+/// @brief Not part of the custom calls, but the push subscription still references it. Swarm players never open a push channel.
+uint8_t network_write(char *devicespec, uint8_t *buf, uint16_t len)
+{
+    return 1;
+}
+
+uint16_t custom_read_appkey(uint16_t creator_id, uint8_t app_id, uint8_t key_id, char *destination)
+{
+    return 0;
+}
+
+void custom_write_appkey(uint16_t creator_id, uint8_t app_id, uint8_t key_id, uint16_t count, char *data)
+{
+}
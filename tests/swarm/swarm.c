@@ -0,0 +1,548 @@
+/*
+  Swarm load generator - runs hundreds of simulated players against a local server stand-in.
+
+  Each player is a forked process running the real state client (src/stateclient.c) and game
+  logic on the host platform, with frames paced at 60 per second and the network calls going
+  to the server over http (network.c). It polls with the same loop as main(), readies up in the
+  lobby, places ships with testShip(), and attacks until STATUS_GAMEOVER. Forking keeps the
+  client's globals per player, so the client code runs unchanged.
+
+  Reports requests and bytes per game, p50/p99 response latency (held long-polls included)
+  and the server's cpu time.
+
+  Build and run with: make swarm SWARM_ARGS="--players 200"
+*/
+
+#define _GNU_SOURCE
+
+// unistd.h has a pause() of its own, which the game's pause() in misc.h would clash with
+#define pause posixPause
+#include <signal.h>
+#include <time.h>
+#include <unistd.h>
+#include <netdb.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/wait.h>
+#undef pause
+
+#include "../../src/misc.h"
+#include "../../src/stateclient.h"
+#include "../../src/gamelogic.h"
+#include "../../src/host/host.h"
+#include "swarm.h"
+
+#define PLAYERS_MAX 2000
+
+SwarmStats *swarmStats;
+
+static const char *tableIds[] = {"basement", "sea", "dev"}; // Then t4, t5.. as fbs_server.c names them
+
+static struct
+{
+    int players, perTable, games, seconds, port, bots, fps;
+    uint32_t seed;
+    const char *host, *server, *capture;
+    pid_t serverPid;
+} opts = {100, 2, 1, 300, 8080, 0, 60, 1, "127.0.0.1", NULL, NULL, 0};
+
+static volatile sig_atomic_t stopping;
+static uint64_t frameNanos;
+
+uint64_t swarmMicros()
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+static uint16_t latencyBucket(uint32_t micros)
+{
+    if (micros < 1000)
+        return micros / 10;
+    if (micros < 10000)
+        return 100 + (micros - 1000) / 100;
+    if (micros < 100000)
+        return 190 + (micros - 10000) / 1000;
+    if (micros < 1000000)
+        return 280 + (micros - 100000) / 10000;
+    return LATENCY_BUCKETS - 1;
+}
+
+/// @brief Upper bound of a latency bucket, in microseconds
+static uint32_t bucketMicros(uint16_t bucket)
+{
+    if (bucket < 100)
+        return (bucket + 1) * 10;
+    if (bucket < 190)
+        return 1000 + (bucket - 99) * 100;
+    if (bucket < 280)
+        return 10000 + (bucket - 189) * 1000;
+    return 100000 + (bucket - 279) * 10000;
+}
+
+void swarmRecordRequest(uint32_t micros, uint32_t sent, uint32_t received, uint32_t body)
+{
+    swarmStats->requests++;
+    swarmStats->wireBytes += sent + received;
+    swarmStats->bodyBytes += body;
+    swarmStats->latency[latencyBucket(micros)]++;
+}
+
+/*****************************************************************
+ * Player
+ *****************************************************************/
+
+/// @brief Frame hook: waits for the next frame on the wall clock, like waitvsync() on the real machine
+static void paceFrame()
+{
+    static struct timespec next;
+    struct timespec now;
+    int64_t behind;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    if (!next.tv_sec)
+        next = now;
+
+    next.tv_nsec += frameNanos;
+    while (next.tv_nsec >= 1000000000)
+    {
+        next.tv_nsec -= 1000000000;
+        next.tv_sec++;
+    }
+
+    // After a long request, carry on from now rather than racing through the missed frames
+    behind = (now.tv_sec - next.tv_sec) * 1000000000LL + now.tv_nsec - next.tv_nsec;
+    if (behind > (int64_t)frameNanos)
+        next = now;
+
+    clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &next, NULL);
+}
+
+/// @brief Picks where to attack: a random cell still open on some opponent's field
+static uint8_t pickTarget()
+{
+    static uint8_t i, pos, tries;
+
+    for (tries = 0; tries < 200; tries++)
+    {
+        pos = getRandomNumber(100);
+        for (i = 1; i < clientState.game.playerCount; i++)
+        {
+            if (clientState.game.players[i].playerStatus == PLAYER_STATUS_DEFAULT &&
+                !FIELD_CELL(clientState.game.players[i].gamefield, pos))
+                return pos;
+        }
+    }
+    return pos;
+}
+
+/// @brief Places the fleet at random, as shipPlacementTask() picks each starting spot
+static void placeFleet()
+{
+    static char command[32];
+    static uint8_t i, pos;
+    char *p;
+
+    memset(tempBuffer, 0, sizeof(tempBuffer));
+    strcpy(command, "place/");
+    p = command + 6;
+    for (i = 0; i < 5; i++)
+    {
+        do
+            pos = getRandomNumber(200);
+        while (!testShip(shipSize[i], pos));
+        placeShip(shipSize[i], pos);
+
+        itoa(pos, p, 10);
+        p += strlen(p);
+        *p++ = i < 4 ? ',' : 0;
+    }
+    queueCommand(command);
+}
+
+/// @brief The player's moves, in place of processInput(), on each new state
+static void decide()
+{
+    static bool readied, placed, finished;
+    static char command[12];
+
+    if (clientState.game.status == STATUS_LOBBY)
+    {
+        placed = finished = false;
+        if (clientState.lobby.playerStatus == PLAYER_STATUS_READY)
+            readied = false;
+        else if (!readied)
+        {
+            queueCommand("ready");
+            readied = true;
+        }
+        return;
+    }
+
+    readied = false;
+    if (clientState.game.status == STATUS_PLACE_SHIPS)
+    {
+        if (clientState.game.playerStatus == PLAYER_STATUS_PLACE_SHIPS && !placed)
+        {
+            placeFleet();
+            placed = true;
+        }
+    }
+    else if (clientState.game.status == STATUS_GAMEOVER)
+    {
+        if (!finished)
+        {
+            finished = true;
+            swarmStats->games++;
+            swarmStats->gameRequests = swarmStats->requests;
+            swarmStats->gameBodyBytes = swarmStats->bodyBytes;
+            swarmStats->gameWireBytes = swarmStats->wireBytes;
+        }
+    }
+    else if (clientState.game.activePlayer == 0 && clientState.game.playerStatus == PLAYER_STATUS_DEFAULT)
+    {
+        strcpy(command, "attack/");
+        itoa(pickTarget(), command + 7, 10);
+        queueCommand(command);
+    }
+}
+
+static void onStop(int sig)
+{
+    stopping = 1;
+}
+
+static void runPlayer(int index)
+{
+    static uint8_t failedApiCalls, result;
+    int table = index / opts.perTable;
+
+    signal(SIGTERM, onStop);
+    signal(SIGINT, SIG_IGN);
+
+    hostReset();
+    hostSeedRandom(opts.seed * 7919 + index + 1);
+    hostFrameHook = paceFrame;
+
+    if (opts.capture)
+    {
+        static char path[256];
+
+        snprintf(path, sizeof(path), "%s/p%d.fbc", opts.capture, index + 1);
+        if (!swarmCapture(path))
+            perror(path);
+    }
+
+    memset(&clientState, 0, sizeof(clientState));
+    memset(&state, 0, sizeof(state));
+    snprintf(serverEndpoint, sizeof(serverEndpoint), "http://%s:%d/", opts.host, opts.port);
+    snprintf(playerName, sizeof(playerName), "p%d", index + 1);
+    if (table < 3)
+        snprintf(query, sizeof(query), "?table=%s&player=%s", tableIds[table], playerName);
+    else
+        snprintf(query, sizeof(query), "?table=t%d&player=%s", table + 1, playerName);
+    state.prevStatus = STATE_INVALID;
+    resetApiSession();
+
+    // The event loop of main(), with decide() standing in for the player at the keyboard
+    state.apiCallWait = 0;
+    while (!stopping && swarmStats->games < (uint32_t)opts.games)
+    {
+        if (!apiBusy() && checkPush())
+            state.apiCallWait = 0;
+
+        if (apiBusy() || !state.apiCallWait--)
+        {
+            switch (result = getStateFromServer())
+            {
+            case STATE_UPDATE_PENDING:
+                break;
+
+            case STATE_UPDATE_ERROR:
+                if (failedApiCalls < 5)
+                    failedApiCalls++;
+                state.apiCallWait = nextPollDelay(failedApiCalls);
+                break;
+
+            default:
+                failedApiCalls = 0;
+                if (result == STATE_UPDATE_CHANGE)
+                    decide();
+                state.apiCallWait = nextPollDelay(0);
+                break;
+            }
+        }
+
+        waitvsync();
+    }
+}
+
+/*****************************************************************
+ * Swarm
+ *****************************************************************/
+
+/// @brief Cpu time of a process in seconds, from /proc, or -1 if unknown
+static double cpuSeconds(pid_t pid)
+{
+    static char path[64], line[1024];
+    unsigned long utime, stime;
+    FILE *f;
+    char *p;
+
+    snprintf(path, sizeof(path), "/proc/%d/stat", (int)pid);
+    f = fopen(path, "r");
+    if (f == NULL)
+        return -1;
+    p = fgets(line, sizeof(line), f) ? strrchr(line, ')') : NULL;
+    fclose(f);
+
+    // utime and stime are the 12th and 13th fields after the command name
+    if (p == NULL || sscanf(p + 2, "%*c %*d %*d %*d %*d %*d %*u %*u %*u %*u %*u %lu %lu", &utime, &stime) != 2)
+        return -1;
+    return (double)(utime + stime) / sysconf(_SC_CLK_TCK);
+}
+
+static bool serverUp()
+{
+    struct addrinfo hints, *addrs;
+    static char port[8];
+    bool up = false;
+    int fd;
+
+    memset(&hints, 0, sizeof(hints));
+    hints.ai_family = AF_INET;
+    hints.ai_socktype = SOCK_STREAM;
+    snprintf(port, sizeof(port), "%d", opts.port);
+    if (getaddrinfo(opts.host, port, &hints, &addrs))
+        return false;
+
+    fd = socket(addrs->ai_family, addrs->ai_socktype, addrs->ai_protocol);
+    if (fd >= 0)
+    {
+        up = !connect(fd, addrs->ai_addr, addrs->ai_addrlen);
+        close(fd);
+    }
+    freeaddrinfo(addrs);
+    return up;
+}
+
+static pid_t startServer()
+{
+    static char port[8], tables[8], bots[8], seed[16];
+    pid_t pid;
+    int i;
+
+    snprintf(port, sizeof(port), "%d", opts.port);
+    snprintf(tables, sizeof(tables), "%d", (opts.players + opts.perTable - 1) / opts.perTable);
+    snprintf(bots, sizeof(bots), "%d", opts.bots);
+    snprintf(seed, sizeof(seed), "%u", opts.seed);
+
+    pid = fork();
+    if (pid == 0)
+    {
+        execl(opts.server, opts.server, "--port", port, "--tables", tables, "--bots", bots, "--seed", seed,
+              "--stats", "0", (char *)NULL);
+        perror(opts.server);
+        _exit(1);
+    }
+
+    for (i = 0; i < 50 && pid > 0; i++)
+    {
+        if (serverUp())
+            return pid;
+        usleep(100000);
+    }
+
+    printf("Server %s did not come up on port %d\n", opts.server, opts.port);
+    if (pid > 0)
+        kill(pid, SIGKILL);
+    exit(1);
+}
+
+static uint32_t percentile(const uint32_t *latency, uint64_t total, double fraction)
+{
+    uint64_t seen = 0, want = (uint64_t)(total * fraction);
+    uint16_t i;
+
+    for (i = 0; i < LATENCY_BUCKETS - 1; i++)
+    {
+        seen += latency[i];
+        if (seen > want)
+            return bucketMicros(i);
+    }
+    return bucketMicros(LATENCY_BUCKETS - 1);
+}
+
+static void report(SwarmStats *players, double seconds, double serverCpu)
+{
+    static SwarmStats sum;
+    uint64_t requests = 0;
+    uint32_t games = 0, done = 0;
+    int i, j;
+
+    memset(&sum, 0, sizeof(sum));
+    for (i = 0; i < opts.players; i++)
+    {
+        sum.requests += players[i].requests;
+        sum.errors += players[i].errors;
+        sum.connects += players[i].connects;
+        sum.bodyBytes += players[i].bodyBytes;
+        sum.wireBytes += players[i].wireBytes;
+        sum.gameRequests += players[i].gameRequests;
+        sum.gameBodyBytes += players[i].gameBodyBytes;
+        sum.gameWireBytes += players[i].gameWireBytes;
+        games += players[i].games;
+        done += players[i].games >= (uint32_t)opts.games;
+        for (j = 0; j < LATENCY_BUCKETS; j++)
+            sum.latency[j] += players[i].latency[j];
+    }
+    for (j = 0; j < LATENCY_BUCKETS; j++)
+        requests += sum.latency[j];
+
+    printf("players          %8d (%u finished %d games) on %d tables, %.1f s\n", opts.players, done, opts.games,
+           (opts.players + opts.perTable - 1) / opts.perTable, seconds);
+    printf("requests         %8u (%.0f/s, %u errors, %u connections)\n", sum.requests, sum.requests / seconds,
+           sum.errors, sum.connects);
+    if (games)
+    {
+        printf("requests/game    %8.1f  (per player)\n", (double)sum.gameRequests / games);
+        printf("bytes/game       %8.0f  (response bodies, per player)\n", (double)sum.gameBodyBytes / games);
+        printf("wire bytes/game  %8.0f  (with http headers and requests)\n", (double)sum.gameWireBytes / games);
+    }
+    if (requests)
+    {
+        printf("latency p50      %8.2f ms\n", percentile(sum.latency, requests, 0.5) / 1000.0);
+        printf("latency p99      %8.2f ms\n", percentile(sum.latency, requests, 0.99) / 1000.0);
+    }
+    if (serverCpu >= 0)
+    {
+        printf("server cpu       %8.2f s (%.1f%% of a core", serverCpu, 100 * serverCpu / seconds);
+        if (games)
+            printf(", %.2f ms per player game", 1000 * serverCpu / games);
+        printf(")\n");
+    }
+}
+
+static void usage(const char *name)
+{
+    printf("usage: %s [--players 100] [--per-table 2] [--games 1] [--seconds 300] [--host 127.0.0.1] [--port 8080]\n"
+           "       [--server r2r/host/fbs_server | --server-pid pid] [--bots 0] [--seed 1] [--fps 60] [--capture dir]\n"
+           "--server starts that server (fbs_server.c options) for the run, --server-pid measures one already running\n"
+           "--capture records each player's calls to dir/p1.fbc.. for make replay\n",
+           name);
+    exit(2);
+}
+
+int main(int argc, char **argv)
+{
+    static pid_t pids[PLAYERS_MAX];
+    SwarmStats *players;
+    double cpuStart = -1, cpuEnd = -1;
+    uint64_t start;
+    int i, running;
+    pid_t pid;
+
+    for (i = 1; i < argc; i++)
+    {
+        if (i + 1 == argc)
+            usage(argv[0]);
+        else if (!strcmp(argv[i], "--players"))
+            opts.players = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "--per-table"))
+            opts.perTable = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "--games"))
+            opts.games = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "--seconds"))
+            opts.seconds = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "--host"))
+            opts.host = argv[++i];
+        else if (!strcmp(argv[i], "--port"))
+            opts.port = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "--server"))
+            opts.server = argv[++i];
+        else if (!strcmp(argv[i], "--server-pid"))
+            opts.serverPid = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "--bots"))
+            opts.bots = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "--seed"))
+            opts.seed = (uint32_t)strtoul(argv[++i], NULL, 0);
+        else if (!strcmp(argv[i], "--fps"))
+            opts.fps = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "--capture"))
+            opts.capture = argv[++i];
+        else
+            usage(argv[0]);
+    }
+
+    if (opts.players < 1 || opts.players > PLAYERS_MAX || opts.perTable < 1 || opts.perTable > PLAYER_MAX ||
+        opts.fps < 1 || (opts.perTable == 1 && !opts.bots))
+    {
+        printf("Need 1 to %d players, 1 to %d per table (or bots to play against) and a positive fps\n", PLAYERS_MAX,
+               PLAYER_MAX);
+        return 2;
+    }
+    frameNanos = 1000000000ULL / opts.fps;
+
+    // Each player writes its stats here as it goes, so players stopped at the time limit still count
+    players = mmap(NULL, sizeof(SwarmStats) * opts.players, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+    if (players == MAP_FAILED)
+    {
+        perror("mmap");
+        return 1;
+    }
+    memset(players, 0, sizeof(SwarmStats) * opts.players);
+
+    if (opts.server)
+        opts.serverPid = startServer();
+    else if (!serverUp())
+    {
+        printf("No server on %s:%d - start one, or pass --server r2r/host/fbs_server\n", opts.host, opts.port);
+        return 1;
+    }
+    if (opts.serverPid)
+        cpuStart = cpuSeconds(opts.serverPid);
+
+    fflush(stdout);
+    start = swarmMicros();
+    for (i = 0; i < opts.players; i++)
+    {
+        pid = fork();
+        if (pid == 0)
+        {
+            swarmStats = &players[i];
+            runPlayer(i);
+            _exit(0);
+        }
+        pids[i] = pid;
+    }
+
+    // Wait for every player to finish its games, or the time limit
+    for (running = opts.players; running;)
+    {
+        while (running && (pid = waitpid(-1, NULL, WNOHANG)) > 0)
+            running--;
+
+        if (running && swarmMicros() - start > (uint64_t)opts.seconds * 1000000)
+        {
+            printf("Time limit reached, stopping %d players\n", running);
+            for (i = 0; i < opts.players; i++)
+                kill(pids[i], SIGTERM);
+            while (running && waitpid(-1, NULL, 0) > 0)
+                running--;
+        }
+        usleep(20000);
+    }
+
+    if (opts.serverPid)
+        cpuEnd = cpuSeconds(opts.serverPid);
+    if (opts.server)
+    {
+        kill(opts.serverPid, SIGTERM);
+        waitpid(opts.serverPid, NULL, 0);
+    }
+
+    report(players, (swarmMicros() - start) / 1e6, cpuStart >= 0 && cpuEnd >= 0 ? cpuEnd - cpuStart : -1);
+    return 0;
+}
@@ -0,0 +1,39 @@
+/*
+  Swarm load generator - simulated players built from the real state client, each in its own process
+*/
+#ifndef SWARM_H
+#define SWARM_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+// Response latency buckets: 10us steps to 1ms, 100us to 10ms, 1ms to 100ms, 10ms to 1s, then one for the rest
+#define LATENCY_BUCKETS 371
+
+typedef struct
+{
+    uint32_t requests;
+    uint32_t errors;        // Failed opens: no connection, timeouts, non 200 responses
+    uint32_t connects;
+    uint64_t bodyBytes;     // Response bodies, what the client reads
+    uint64_t wireBytes;     // Requests and responses, headers included
+    uint32_t games;         // Games seen through to STATUS_GAMEOVER
+    uint32_t gameRequests;  // requests, bodyBytes and wireBytes when the last game ended
+    uint64_t gameBodyBytes;
+    uint64_t gameWireBytes;
+    uint32_t latency[LATENCY_BUCKETS];
+} SwarmStats;
+
+// This player's stats, in memory shared with the parent process
+extern SwarmStats *swarmStats;
+
+/// @brief Counts a completed request and its round trip time
+void swarmRecordRequest(uint32_t micros, uint32_t sent, uint32_t received, uint32_t body);
+
+/// @brief Monotonic clock in microseconds
+uint64_t swarmMicros();
+
+/// @brief Records this player's calls to a capture file (tests/replay/capture.h). Returns false if it cannot be created.
+bool swarmCapture(const char *path);
+
+#endif /* SWARM_H */